@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# Generates src/ledcoords.h, a table of each LED's position on the board, from the D* footprints in the kicad_pcb.
+# Rerun after moving LEDs (e.g. with layout.py):
+#   python3 board/ledcoords.py -p board/earthvenusmars.kicad_pcb -o src/ledcoords.h
+import argparse
+import math
+import os
+import re
+import sys
+
+parser = argparse.ArgumentParser()
+parser.add_argument('-p', "--path", action='store', required=True, help="Path to kicad_pcb file")
+parser.add_argument('-o', "--output", action='store', required=True, help="Path to write the header to")
+args = parser.parse_args()
+
+# circle is pixels D1-D12, D31-D39, D54-D66, its center is the origin
+CIRCLE_REFS = list(range(1, 13)) + list(range(31, 40)) + list(range(54, 67))
+
+def read_led_positions(pcb_path):
+	"""Returns {led number: (x mm, y mm)} for every D* footprint. KiCad's y axis points down."""
+	with open(pcb_path) as f:
+		pcb = f.read()
+	positions = {}
+	for footprint in re.split(r'\n\t\(footprint ', pcb)[1:]:
+		ref = re.search(r'\(property "Reference" "D(\d+)"', footprint)
+		if not ref:
+			continue
+		at = re.search(r'\n\t\t\(at ([-\d.]+) ([-\d.]+)', footprint)
+		positions[int(ref.group(1))] = (float(at.group(1)), float(at.group(2)))
+	return positions
+
+positions = read_led_positions(os.path.abspath(args.path))
+refs = sorted(positions)
+if refs != list(range(1, len(refs) + 1)):
+	sys.exit("expected D1-D%i, found %s" % (len(refs), refs))
+
+cx = sum(positions[r][0] for r in CIRCLE_REFS) / len(CIRCLE_REFS)
+cy = sum(positions[r][1] for r in CIRCLE_REFS) / len(CIRCLE_REFS)
+
+polar = {}
+for r in refs:
+	dx, dy = positions[r][0] - cx, positions[r][1] - cy
+	polar[r] = (math.hypot(dx, dy), math.atan2(dy, dx) % (2 * math.pi))
+max_radius = max(p[0] for p in polar.values())
+
+coords = []
+for r in refs:
+	dx, dy = positions[r][0] - cx, positions[r][1] - cy
+	radius, angle = polar[r]
+	coords.append((
+		int(round(127 * dx / max_radius)),
+		int(round(127 * dy / max_radius)),
+		int(round(256 * angle / (2 * math.pi))) % 256,
+		int(round(255 * radius / max_radius)),
+	))
+
+# led indexes are D numbers minus one
+by_angle = sorted(range(len(coords)), key=lambda i: (coords[i][2], coords[i][3]))
+
+with open(args.output, 'w') as out:
+	out.write("""#ifndef LEDCOORDS_H
+#define LEDCOORDS_H
+
+// Generated by board/ledcoords.py from %s, don't edit by hand.
+
+#include <stdint.h>
+
+// Position of an LED relative to the center of the circle. x and y run -127..127 across the farthest LED from the center,
+// with y pointing down the board as in KiCad. angle is a fraction of a turn out of 256 measured clockwise from +x,
+// and radius runs 0..255 out to the farthest LED.
+struct LEDCoord {
+  int8_t x, y;
+  uint8_t angle;
+  uint8_t radius;
+};
+
+// microns per x/y unit
+const uint16_t kLEDCoordScaleMicrons = %i;
+
+constexpr LEDCoord kLEDCoords[%i] = {
+""" % (os.path.basename(args.path), int(round(1000 * max_radius / 127)), len(coords)))
+	for i, (x, y, angle, radius) in enumerate(coords):
+		out.write("  {%4i, %4i, %3i, %3i}, // D%i\n" % (x, y, angle, radius, i + 1))
+	out.write("""};
+
+// led indexes ordered by angle, then by radius
+constexpr uint8_t kLEDsByAngle[%i] = {
+""" % len(coords))
+	for start in range(0, len(by_angle), 13):
+		out.write("  " + ", ".join("%2i" % i for i in by_angle[start:start + 13]) + ",\n")
+	out.write("""};
+
+#endif
+""")
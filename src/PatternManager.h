@@ -5,6 +5,7 @@
 
 #include "patterns.h"
 #include "ledgraph.h"
+#include "ledoutput.h"
 #include "controls.h"
 #include "config.h"
 
@@ -22,6 +23,10 @@ class PatternManager {
 
   BufferType &ctx;
 
+  // the active pattern, then the spoke layers from SpokePatternManager::attachLayers
+  Compositor<BufferType, PixelMask, blendBrighten, blendBrighten, blendSubtract> compositor;
+  enum { patternLayer, spokeLayers };
+
   HardwareControls controls;
   TouchButton *touchPads[3] = {0};
 
@@ -100,7 +105,7 @@ class PatternManager {
       }
     });
     ctx.leds.fill_solid(CRGB::Black);
-    FastLED.show();
+    ledOutput.show();
   }
 
   void setupButtons() {
@@ -354,6 +359,7 @@ public:
     assert(colorManager == NULL, "colorManager is not null");
     colorManager = new EVMColorManager();
     spokeManager = new SpokePatternManager();
+    spokeManager->attachLayers(compositor, spokeLayers);
 #if EVM_HARDWARE_VERSION > 1
     spokeManager->colorManager = colorManager;
 #endif
@@ -368,8 +374,6 @@ public:
   }
 
   void loop() {
-    ctx.leds.fill_solid(CRGB::Black);
-
     if (spokeManager && !spokeManager->isRunning()) {
       spokeManager->colorModeChanged();
       spokeManager->start();
@@ -391,16 +395,18 @@ public:
 
       if (activePatternBrightness > 0) {
         activePattern->loop();
-        activePattern->ctx.blendIntoContext(ctx, BlendMode::blendBrighten, dim8_raw(activePatternBrightness));
+        activePattern->ctx.markDirty();
       }
     }
+    compositor.layers[patternLayer].source = (activePattern && activePatternBrightness > 0 ? &activePattern->ctx : NULL);
+    compositor.layers[patternLayer].opacity = dim8_raw(activePatternBrightness);
 
     if (spokeManager) {
       spokeManager->loop();
-      spokeManager->ctx.blendIntoContext(ctx, BlendMode::blendBrighten);
-      spokeManager->subtractCtx.blendIntoContext(ctx, BlendMode::blendSubtract);
     }
 
+    compositor.compose(ctx);
+
     // time out idle patterns
     if (patternAutoRotate && activePattern != NULL && activePattern->isRunning() && activePattern->runTime() > patternTimeout) {
       if (activePattern != TestIdlePattern() && activePattern->wantsToIdleStop()) {
@@ -32,6 +32,12 @@
 #define BUTTON_PIN_3 19  // PB02  Use for top-right spoke
 #endif
 
+// Estimated LED current brightness is capped to, in mA, 0 for no limit. Full white at full brightness is around 3A,
+// which browns out most USB battery packs, and their ports are usually rated 2-2.4A.
+#ifndef LED_CURRENT_BUDGET_MA
+#define LED_CURRENT_BUDGET_MA 2000
+#endif
+
 #define UNCONNECTED_PIN_1 A1  // PB08
 #define UNCONNECTED_PIN_2 A0  // PA02
 
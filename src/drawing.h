@@ -3,6 +3,8 @@
 #define DRAWING_H
 
 #include <stack>
+#include <type_traits>
+#include <utility>
 #include <FastLED.h>
 
 // Workaround for linker issues when using copy-constructors for DrawStyle struct (since something is built with -fno-exceptions)
@@ -23,80 +25,626 @@ public:
   bool wrap = false;
 };
 
-template<unsigned WIDTH, unsigned HEIGHT, class PixelType, class PixelSetType>
-class CustomDrawingContext {
+// Helpers for blending four 8-bit channels packed into a word at once, without carries crossing between lanes.
+
+// per-lane a - b, clamped at 0 like qsub8
+inline __attribute__((always_inline)) uint32_t qsub8x4(uint32_t a, uint32_t b) {
+  const uint32_t high = 0x80808080;
+  uint32_t diff = ((a | high) - (b & ~high)) ^ ((a ^ ~b) & high);
+  uint32_t borrow = ((~a & b) | (~(a ^ b) & diff)) & high;
+  return diff & ~((borrow >> 7) * 0xFF);
+}
+
+inline __attribute__((always_inline)) uint32_t max8x4(uint32_t a, uint32_t b) {
+  return b + qsub8x4(a, b);
+}
+
+inline __attribute__((always_inline)) uint32_t min8x4(uint32_t a, uint32_t b) {
+  return a - qsub8x4(a, b);
+}
+
+// per-lane scale8, c * (scale + 1) / 256, two lanes at a time in 16-bit halves
+inline __attribute__((always_inline)) uint32_t scale8x4(uint32_t c, uint8_t scale) {
+  const uint16_t fixed = scale + 1;
+  return ((((c & 0x00FF00FF) * fixed) >> 8) & 0x00FF00FF) | ((((c >> 8) & 0x00FF00FF) * fixed) & 0xFF00FF00);
+}
+
+// one blend mode's op on packed channels, src scaled by brightness first if Scaled
+template<BlendMode Mode, bool Scaled>
+inline __attribute__((always_inline)) uint32_t blend8x4(uint32_t dst, uint32_t src, uint8_t brightness) {
+  if (Scaled) {
+    src = scale8x4(src, brightness);
+  }
+  switch (Mode) {
+    case blendSourceOver: return src;
+    case blendBrighten: return max8x4(src, dst);
+    case blendDarken: return min8x4(src, dst);
+    case blendSubtract: return qsub8x4(dst, src);
+  }
+  return dst;
+}
+
+// dst = blend8x4(dst, src) over count bytes, a word at a time where the buffers are word aligned
+template<BlendMode Mode, bool Scaled>
+void blendChannels(uint8_t *dst, const uint8_t *src, unsigned count, uint8_t brightness) {
+  unsigned i = 0;
+  if ((((uintptr_t)dst | (uintptr_t)src) & 3) == 0) {
+    for (; i + 4 <= count; i += 4) {
+      uint32_t d, s;
+      memcpy(&d, __builtin_assume_aligned(dst + i, 4), 4);
+      memcpy(&s, __builtin_assume_aligned(src + i, 4), 4);
+      d = blend8x4<Mode, Scaled>(d, s, brightness);
+      memcpy(__builtin_assume_aligned(dst + i, 4), &d, 4);
+    }
+  }
+  for (; i < count; ++i) {
+    dst[i] = blend8x4<Mode, Scaled>(dst[i], src[i], brightness);
+  }
+}
+
+// scales count bytes in place like nscale8, returning all of the results or'd together so callers can tell when they're all 0
+inline uint32_t scaleChannels(uint8_t *buf, unsigned count, uint8_t scale) {
+  uint32_t lit = 0;
+  unsigned i = 0;
+  if (((uintptr_t)buf & 3) == 0) {
+    for (; i + 4 <= count; i += 4) {
+      uint32_t w;
+      memcpy(&w, __builtin_assume_aligned(buf + i, 4), 4);
+      w = scale8x4(w, scale);
+      lit |= w;
+      memcpy(__builtin_assume_aligned(buf + i, 4), &w, 4);
+    }
+  }
+  for (; i < count; ++i) {
+    buf[i] = scale8x4(buf[i], scale);
+    lit |= buf[i];
+  }
+  return lit;
+}
+
+/* 8.8 fixed point pixels */
+
+// The same helpers for two 16-bit lanes packed into a word.
+
+// per-lane a - b, clamped at 0
+inline __attribute__((always_inline)) uint32_t qsub16x2(uint32_t a, uint32_t b) {
+  const uint32_t high = 0x80008000;
+  uint32_t diff = ((a | high) - (b & ~high)) ^ ((a ^ ~b) & high);
+  uint32_t borrow = ((~a & b) | (~(a ^ b) & diff)) & high;
+  return diff & ~((borrow >> 15) * 0xFFFF);
+}
+
+inline __attribute__((always_inline)) uint32_t max16x2(uint32_t a, uint32_t b) {
+  return b + qsub16x2(a, b);
+}
+
+inline __attribute__((always_inline)) uint32_t min16x2(uint32_t a, uint32_t b) {
+  return a - qsub16x2(a, b);
+}
+
+// per-lane a + b, clamped at 0xFFFF
+inline __attribute__((always_inline)) uint32_t qadd16x2(uint32_t a, uint32_t b) {
+  return a + min16x2(b, ~a);
+}
+
+// per-lane c * fixed / 256 for fixed up to 256. The high and low bytes of each lane are scaled separately so that
+// no product spills into the next lane.
+inline __attribute__((always_inline)) uint32_t scale16x2(uint32_t c, uint16_t fixed) {
+  return ((c >> 8) & 0x00FF00FF) * fixed + ((((c & 0x00FF00FF) * fixed) >> 8) & 0x00FF00FF);
+}
+
+template<BlendMode Mode, bool Scaled>
+inline __attribute__((always_inline)) uint32_t blend16x2(uint32_t dst, uint32_t src, uint8_t brightness) {
+  if (Scaled) {
+    src = scale16x2(src, brightness + 1);
+  }
+  switch (Mode) {
+    case blendSourceOver: return src;
+    case blendBrighten: return max16x2(src, dst);
+    case blendDarken: return min16x2(src, dst);
+    case blendSubtract: return qsub16x2(dst, src);
+  }
+  return dst;
+}
+
+// An RGB pixel with 8.8 fixed point channels, 0xFF00 being full, for drawing that needs more than 8 bits per channel
+// without going through soft-float. r and g share the first word and b has the low half of the second, so the
+// operations below work on two channels at a time.
+struct QCRGB {
+  union {
+    struct {
+      uint16_t r, g, b;
+      uint16_t unused; // always 0
+    };
+    uint16_t raw[4];
+    uint32_t words[2];
+  };
+
+  QCRGB() : unused(0) { }
+  QCRGB(uint16_t r, uint16_t g, uint16_t b) : r(r), g(g), b(b), unused(0) { }
+  QCRGB(CRGB color) : QCRGB(color.r << 8, color.g << 8, color.b << 8) { }
+  QCRGB(CRGB::HTMLColorCode code) : QCRGB(CRGB(code)) { }
+
+  inline uint16_t& operator[] (uint8_t x) __attribute__((always_inline)) {
+    return raw[x];
+  }
+
+  // drops the fractions, explicit so that 8-bit blends don't get picked by accident
+  explicit operator CRGB() const {
+    return CRGB(r >> 8, g >> 8, b >> 8);
+  }
+
+  // saturating, like CRGB's
+  inline QCRGB& operator+= (const QCRGB &rhs) {
+    words[0] = qadd16x2(words[0], rhs.words[0]);
+    words[1] = qadd16x2(words[1], rhs.words[1]);
+    return *this;
+  }
+
+  inline QCRGB& operator-= (const QCRGB &rhs) {
+    words[0] = qsub16x2(words[0], rhs.words[0]);
+    words[1] = qsub16x2(words[1], rhs.words[1]);
+    return *this;
+  }
+
+  // scales by (scale + 1) / 256 like CRGB::nscale8, keeping the fraction
+  inline QCRGB& nscale8(uint8_t scale) {
+    words[0] = scale16x2(words[0], scale + 1);
+    words[1] = scale16x2(words[1], scale + 1);
+    return *this;
+  }
+
+  inline QCRGB& fadeToBlackBy(uint8_t amount) {
+    return nscale8(0xFF - amount);
+  }
+};
+
+inline QCRGB operator+ (QCRGB p1, const QCRGB &p2) {
+  return p1 += p2;
+}
+
+inline QCRGB operator- (QCRGB p1, const QCRGB &p2) {
+  return p1 -= p2;
+}
+
+// p1 * (256 - amountOfP2) / 256 + p2 * amountOfP2 / 256, like FastLED's blend
+inline QCRGB blend(const QCRGB &p1, const QCRGB &p2, uint8_t amountOfP2) {
+  QCRGB out;
+  for (uint8_t w = 0; w < 2; ++w) {
+    out.words[w] = scale16x2(p1.words[w], 0x100 - amountOfP2) + scale16x2(p2.words[w], amountOfP2);
+  }
+  return out;
+}
+
+template<int SIZE>
+class QCRGBArray {
+  QCRGB entries[SIZE];
+public:
+  inline QCRGB& operator[] (uint16_t x) __attribute__((always_inline)) {
+    return entries[x];
+  }
+
+  inline const QCRGB& operator[] (uint16_t x) const __attribute__((always_inline)) {
+    return entries[x];
+  }
+
+  constexpr int size() const {
+    return SIZE;
+  }
+
+  void fill_solid(const QCRGB &color) {
+    for (QCRGB &entry : entries) {
+      entry = color;
+    }
+  }
+};
+
+// The blend and fade kernels for each kind of pixel CustomDrawingContext can hold, over count pixels.
+
+template<BlendMode Mode, bool Scaled>
+inline void blendPixels(CRGB *dst, const CRGB *src, unsigned count, uint8_t brightness) {
+  blendChannels<Mode, Scaled>((uint8_t *)dst, (const uint8_t *)src, 3 * count, brightness);
+}
+
+template<BlendMode Mode, bool Scaled>
+void blendPixels(QCRGB *dst, const QCRGB *src, unsigned count, uint8_t brightness) {
+  for (unsigned i = 0; i < count; ++i) {
+    dst[i].words[0] = blend16x2<Mode, Scaled>(dst[i].words[0], src[i].words[0], brightness);
+    dst[i].words[1] = blend16x2<Mode, Scaled>(dst[i].words[1], src[i].words[1], brightness);
+  }
+}
+
+// scales like nscale8, returning all of the results or'd together so callers can tell when they're all 0
+inline uint32_t scalePixels(CRGB *pixels, unsigned count, uint8_t scale) {
+  return scaleChannels((uint8_t *)pixels, 3 * count, scale);
+}
+
+inline uint32_t scalePixels(QCRGB *pixels, unsigned count, uint8_t scale) {
+  uint32_t lit = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    pixels[i].nscale8(scale);
+    lit |= pixels[i].words[0] | pixels[i].words[1];
+  }
+  return lit;
+}
+
+// The fraction of a fading value left after some milliseconds, for fading by half-life instead of by an amount per frame.
+// Fading over two 8ms frames leaves the same as over one 16ms frame, so trails look the same at any frame rate, and a
+// long frame fades further instead of wrapping around. The table holds the fraction left after each step of up to
+// MaxStepMillis in 0.16 fixed point, built once whenever the half-life changes. Longer steps chain the longest one.
+class DecayTable {
+public:
+  static const uint32_t One = 0x10000;
+  static const uint8_t MaxStepMillis = 64;
+
 private:
-  void set_px(CustomDrawingContext<WIDTH, HEIGHT, PixelType, PixelSetType> &dstCtx, PixelType src, int index, BlendMode blendMode, uint8_t brightness) {
-    src.nscale8(brightness);
-    switch (blendMode) {
-      case blendSourceOver:
-        dstCtx.leds[index] = src;
-        break;
-      case blendBrighten: {
-        PixelType dst = dstCtx.leds[index];
-        dstCtx.leds[index] = PixelType(std::max(src.r, dst.r), std::max(src.g, dst.g), std::max(src.b, dst.b));
-        break;
+  uint16_t halfLife = 0;
+  uint16_t factors[MaxStepMillis]; // factors[dt - 1]
+
+public:
+  DecayTable(uint16_t halfLifeMillis) {
+    setHalfLife(halfLifeMillis);
+  }
+
+  uint16_t halfLifeMillis() const {
+    return halfLife;
+  }
+
+  // a half-life of 0 turns fading off
+  void setHalfLife(uint16_t halfLifeMillis) {
+    if (halfLifeMillis == halfLife) {
+      return;
+    }
+    halfLife = halfLifeMillis;
+    if (halfLife == 0) {
+      return;
+    }
+    // float only here, never per frame
+    const float perMilli = exp2f(-1.f / halfLife);
+    float left = 1;
+    for (uint8_t dt = 1; dt <= MaxStepMillis; ++dt) {
+      left *= perMilli;
+      factors[dt - 1] = MIN(0xFFFF, (uint32_t)(left * One + 0.5f));
+    }
+  }
+
+  // the fraction left after elapsedMillis, out of One
+  uint32_t factor(unsigned long elapsedMillis) const {
+    if (halfLife == 0 || elapsedMillis == 0) {
+      return One;
+    }
+    uint32_t left = One;
+    while (elapsedMillis > MaxStepMillis) {
+      left = (left * factors[MaxStepMillis - 1]) >> 16;
+      elapsedMillis -= MaxStepMillis;
+      if (left == 0) {
+        return 0;
       }
-      case blendDarken: {
-        PixelType dst = dstCtx.leds[index];
-        dstCtx.leds[index] = PixelType(std::min(src.r, dst.r), std::min(src.g, dst.g), std::min(src.b, dst.b));
+    }
+    return (left * factors[elapsedMillis - 1]) >> 16;
+  }
+};
+
+// Decays same-size 8-bit contexts by a DecayTable factor in one pass over their channels, for layers that fade together.
+// Each channel carries the fraction of a step it has decayed past along with it (see decayFractions) and decays as 8.8,
+// so trails follow the curve to within a step at any frame rate instead of losing up to a step every frame.
+template<class... Contexts>
+void decayContexts(uint32_t factor, Contexts &...contexts) {
+  if (factor >= DecayTable::One) {
+    return;
+  }
+  if (factor == 0) {
+    (contexts.clear(), ...);
+    return;
+  }
+  static_assert(((sizeof(contexts.leds[0]) == 3) && ...), "decaying contexts together works on 8-bit pixels");
+  const uint8_t ContextCount = sizeof...(Contexts);
+  uint8_t *channels[ContextCount] = {(contexts.isBlack() ? NULL : (uint8_t *)&contexts.leds[0])...};
+  uint8_t *fractions[ContextCount] = {(contexts.isBlack() ? NULL : contexts.decayFractions())...};
+  const unsigned counts[ContextCount] = {(unsigned)(sizeof(contexts.leds[0]) * contexts.leds.size())...};
+  for (uint8_t c = 0; c < ContextCount; ++c) {
+    assert(counts[c] == counts[0], "decaying contexts together requires same-size buffers");
+  }
+  uint8_t lit[ContextCount] = {0};
+  for (unsigned i = 0; i < counts[0]; ++i) {
+    for (uint8_t c = 0; c < ContextCount; ++c) {
+      if (channels[c]) {
+        // truncating still takes at least a 256th of a step, so faint channels always make it to black
+        uint32_t value = ((uint32_t)channels[c][i] << 8 | fractions[c][i]) * factor >> 16;
+        channels[c][i] = value >> 8;
+        fractions[c][i] = value;
+        lit[c] |= channels[c][i];
       }
-      case blendSubtract: {
-        PixelType dst = dstCtx.leds[index];
-        dstCtx.leds[index] = dst - src;
+    }
+  }
+  uint8_t c = 0;
+  ((channels[c] && lit[c] == 0 ? contexts.clear() : (void)0, ++c), ...);
+}
+
+template<unsigned WIDTH, unsigned HEIGHT, class PixelType, class PixelSetType>
+class CustomDrawingContext {
+private:
+  static_assert(std::is_same<PixelType, CRGB>::value || std::is_same<PixelType, QCRGB>::value, "no blend kernels for this pixel type");
+
+  // Every pixel is known to be black, so blending or fading this context can be skipped. Only kept up to date by the
+  // context's own methods, code that writes to leds directly must call markDirty() afterward.
+  bool black = true;
+
+  uint8_t *fractions = NULL;
+
+  template<BlendMode Mode>
+  void blendInto(CustomDrawingContext<WIDTH, HEIGHT, PixelType, PixelSetType> &dstCtx, uint8_t brightness) {
+    if (brightness == 0xFF) {
+      blendPixels<Mode, false>(&dstCtx.leds[0], &leds[0], leds.size(), brightness);
+    } else {
+      blendPixels<Mode, true>(&dstCtx.leds[0], &leds[0], leds.size(), brightness);
+    }
+  }
+
+  void decay(uint32_t factor, CRGB *) {
+    decayContexts(factor, *this);
+  }
+
+  void decay(uint32_t factor, QCRGB *pixels) {
+    if (black || factor >= DecayTable::One) {
+      return;
+    }
+    uint16_t lit = 0;
+    for (unsigned i = 0; i < WIDTH * HEIGHT; ++i) {
+      for (uint8_t c = 0; c < 3; ++c) {
+        pixels[i][c] = (pixels[i][c] * factor) >> 16;
+        lit |= pixels[i][c];
       }
     }
+    black = (lit == 0);
   }
 public:
-  PixelSetType leds;
+  alignas(uint32_t) PixelSetType leds; // so the blend and fade kernels can always go a word at a time
   CustomDrawingContext() {  
     leds.fill_solid(CRGB::Black);
   }
+  ~CustomDrawingContext() {
+    delete[] fractions;
+  }
+  CustomDrawingContext(const CustomDrawingContext &) = delete;
+  CustomDrawingContext &operator=(const CustomDrawingContext &) = delete;
   
+  inline bool isBlack() const {
+    return black;
+  }
+
+  inline void markDirty() {
+    black = false;
+  }
+
+  void clear() {
+    leds.fill_solid(CRGB::Black);
+    if (fractions) {
+      memset(fractions, 0, sizeof(leds[0]) * leds.size());
+    }
+    black = true;
+  }
+
+  // The fraction of a step below each 8-bit channel that decayContexts keeps, one byte per channel. Drawing over a
+  // channel leaves its fraction, which adds less than a step. Allocated on the first decay, so contexts that never
+  // decay don't pay for it.
+  uint8_t *decayFractions() {
+    if (!fractions) {
+      fractions = new uint8_t[sizeof(leds[0]) * leds.size()]();
+    }
+    return fractions;
+  }
+
+  void fadeToBlackBy(uint8_t amount) {
+    if (black || amount == 0) {
+      return;
+    }
+    black = scalePixels(&leds[0], leds.size(), 0xFF - amount) == 0;
+  }
+
+  // fades by a DecayTable factor, see decayContexts. QCRGB pixels keep their fractions.
+  void decay(uint32_t factor) {
+    decay(factor, &leds[0]);
+  }
+
   void blendIntoContext(CustomDrawingContext<WIDTH, HEIGHT, PixelType, PixelSetType> &otherContext, BlendMode blendMode, uint8_t brightness=0xFF) {
     assert(otherContext.leds.size() == this->leds.size(), "context blending requires same-size buffers");
-    for (int i = 0; i < leds.size(); ++i) {
-      set_px(otherContext, leds[i], i, blendMode, brightness);
+    if (black) {
+      // black only shows up in what it's blended into when it replaces or darkens it
+      if (blendMode == blendSourceOver || blendMode == blendDarken) {
+        otherContext.clear();
+      }
+      return;
+    }
+    if (blendMode == blendSourceOver || blendMode == blendBrighten) {
+      otherContext.markDirty();
+    }
+    switch (blendMode) {
+      case blendSourceOver: blendInto<blendSourceOver>(otherContext, brightness); break;
+      case blendBrighten: blendInto<blendBrighten>(otherContext, brightness); break;
+      case blendDarken: blendInto<blendDarken>(otherContext, brightness); break;
+      case blendSubtract: blendInto<blendSubtract>(otherContext, brightness); break;
     }
   }
 };
 
-/* Floating-point pixel buffer support */
+// Which bytes of each of the three words covering four packed RGB pixels belong to pixels set in a 4-bit pixel mask,
+// as lane masks. Four pixels span 12 bytes, split 3+1, 2+2 and 1+3 between pairs of pixels across the three words.
+struct PixelLaneMasks {
+  uint32_t lanes[3][16];
+};
 
-typedef struct FCRGB {
-  union {
-    struct {
-      union {
-        float r;
-        float red;
-      };
-      union {
-        float g;
-        float green;
-      };
-      union {
-        float b;
-        float blue;
-      };
-    };
-    float raw[3];
-  };
-public:
-  FCRGB() { }
-  FCRGB(CRGB color) : red(color.r), green(color.g), blue(color.b) { }
-  FCRGB(float r, float g, float b) : red(r), green(g), blue(b) { }
-  inline float& operator[] (uint8_t x) __attribute__((always_inline)) {
-    return raw[x];
+constexpr PixelLaneMasks MakePixelLaneMasks() {
+  PixelLaneMasks masks = {};
+  for (unsigned word = 0; word < 3; ++word) {
+    for (unsigned pixels = 0; pixels < 16; ++pixels) {
+      for (unsigned lane = 0; lane < 4; ++lane) {
+        if (pixels & (1 << ((4 * word + lane) / 3))) {
+          masks.lanes[word][pixels] |= 0xFFu << (8 * lane);
+        }
+      }
+    }
   }
-} FCRGB;
+  return masks;
+}
 
-template<int SIZE>
-class FCRGBArray {
-  FCRGB entries[SIZE];
+constexpr PixelLaneMasks kPixelLaneMasks = MakePixelLaneMasks();
+
+// Blends a stack of layers into an output context in a single pass, reading each layer and writing the output once
+// per pixel instead of once per layer. Layers apply bottom up over black, blending with the mode declared for them in
+// Modes. Each also has an opacity and optionally a Mask (a BasicPixelMask) limiting it to some pixels.
+// The stack is fixed at compile time so the per-pixel work inlines into one loop with no dispatch on blend modes.
+template<class Context, class Mask, BlendMode... Modes>
+class Compositor {
+  static_assert(sizeof(std::declval<Context &>().leds[0]) == 3, "compositing works on packed 8-bit RGB pixels");
 public:
-  inline FCRGB& operator[] (uint16_t x) __attribute__((always_inline)) {
-    return entries[x];
+  static const uint8_t LayerCount = sizeof...(Modes);
+
+  struct Layer {
+    const Context *source = NULL; // hidden while NULL
+    uint8_t opacity = 0xFF;
+    const Mask *mask = NULL; // pixels the layer applies to, every pixel if NULL
   };
+
+  Layer layers[LayerCount];
+
+private:
+  static inline const uint8_t *channels(const Context &context) {
+    return (const uint8_t *)&context.leds[0];
+  }
+
+  // whether the layer can change the output, black or transparent layers that brighten or subtract can't
+  template<BlendMode Mode>
+  inline bool isVisible(const Layer &layer) const {
+    if (!layer.source) {
+      return false;
+    }
+    bool noop = layer.source->isBlack() || layer.opacity == 0;
+    return !(noop && (Mode == blendBrighten || Mode == blendSubtract));
+  }
+
+  // the four pixels from 4 * group in mask, as bits
+  static inline __attribute__((always_inline)) uint8_t maskNybble(const Mask &mask, unsigned group) {
+    return (mask.word(group >> 3) >> (4 * (group & 7))) & 0xF;
+  }
+
+  // blends one layer's three words for the group of four pixels starting at byte i into acc
+  template<BlendMode Mode>
+  static inline __attribute__((always_inline)) void blendGroup(const Layer &layer, unsigned group, unsigned i, uint32_t *acc) {
+    uint32_t src[3];
+    memcpy(src, __builtin_assume_aligned(channels(*layer.source) + i, 4), 12);
+    const uint8_t nybble = layer.mask ? maskNybble(*layer.mask, group) : 0xF;
+    if (nybble == 0) {
+      return;
+    }
+    for (uint8_t w = 0; w < 3; ++w) {
+      uint32_t blended = blend8x4<Mode, false>(acc[w], layer.opacity == 0xFF ? src[w] : scale8x4(src[w], layer.opacity), 0xFF);
+      uint32_t lanes = kPixelLaneMasks.lanes[w][nybble];
+      acc[w] = (blended & lanes) | (acc[w] & ~lanes);
+    }
+  }
+
+  template<BlendMode Mode>
+  static inline __attribute__((always_inline)) void blendByte(const Layer &layer, unsigned i, uint32_t &acc) {
+    if (!layer.mask || layer.mask->contains(i / 3)) {
+      acc = blend8x4<Mode, true>(acc, channels(*layer.source)[i], layer.opacity);
+    }
+  }
+
+  template<class Finish, size_t... L>
+  void compose(Context &out, Finish finish, std::index_sequence<L...>) {
+    const bool visible[LayerCount] = {isVisible<Modes>(layers[L])...};
+    uintptr_t alignment = (uintptr_t)channels(out);
+    for (uint8_t l = 0; l < LayerCount; ++l) {
+      if (visible[l]) {
+        alignment |= (uintptr_t)channels(*layers[l].source);
+      }
+    }
+    uint8_t *dst = (uint8_t *)channels(out);
+    const unsigned count = sizeof(out.leds[0]) * out.leds.size();
+
+    unsigned i = 0;
+    if ((alignment & 3) == 0) {
+      // whole groups of four pixels, three words at a time
+      for (unsigned group = 0; i + 12 <= count; ++group, i += 12) {
+        uint32_t acc[3] = {0, 0, 0};
+        ((visible[L] ? blendGroup<Modes>(layers[L], group, i, acc) : (void)0), ...);
+        for (uint8_t w = 0; w < 3; ++w) {
+          acc[w] = finish(acc[w]);
+        }
+        memcpy(__builtin_assume_aligned(dst + i, 4), acc, 12);
+      }
+    }
+    for (; i < count; ++i) {
+      uint32_t acc = 0;
+      ((visible[L] ? blendByte<Modes>(layers[L], i, acc) : (void)0), ...);
+      dst[i] = finish(acc);
+    }
+    out.markDirty();
+  }
+
+public:
+  void compose(Context &out) {
+    bool anyVisible = false;
+    for (uint8_t l = 0; l < LayerCount; ++l) {
+      anyVisible |= (layers[l].source && !layers[l].source->isBlack());
+    }
+    if (!anyVisible) {
+      out.clear();
+      return;
+    }
+    compose(out, [](uint32_t channels) { return channels; });
+  }
+
+  // Composes into out, passing each word of finished output channels through finish(channels) on its way out.
+  // finish works on packed channels like the blend helpers, e.g. to apply a per-channel curve to the final output.
+  template<class Finish>
+  void compose(Context &out, Finish finish) {
+    compose(out, finish, std::make_index_sequence<LayerCount>());
+  }
 };
 
+// a drawing context covering every LED on a board, see BoardLayout
+template <class Layout>
+using LayoutDrawingContext = CustomDrawingContext<Layout::LEDCount, 1, CRGB, CRGBArray<Layout::LEDCount> >;
+
+// A drawing context with 8.8 fixed point pixels, for drawing that builds up over many frames. Trails faded a little every
+// frame step visibly and stick or vanish early at 8 bits, here they keep their fraction until they're resolved to 8 bits
+// for compositing.
+template<unsigned WIDTH, unsigned HEIGHT>
+using AccumulationContext = CustomDrawingContext<WIDTH, HEIGHT, QCRGB, QCRGBArray<WIDTH * HEIGHT> >;
+
+template <class Layout>
+using LayoutAccumulationContext = AccumulationContext<Layout::LEDCount, 1>;
+
+// Rounds an 8.8 channel down to 8 bits, temporally dithered: the fraction it drops carries over in residual to the next
+// frame, so a channel resolved every frame averages out to its exact value. Values under one step aren't dithered,
+// which would only flicker.
+static inline uint8_t ditherChannel(uint16_t value, uint8_t &residual) {
+  if (value < 0x100) {
+    residual = 0;
+    return 0;
+  }
+  const uint32_t sum = value + residual;
+  residual = sum & 0xFF;
+  return sum > 0xFFFF ? 0xFF : sum >> 8;
+}
+
+// Resolves an accumulation context into a same-size 8-bit one, dithering each channel's fraction with ditherChannel.
+// residuals holds a byte per channel and has to be kept by the caller from one resolve to the next.
+template<unsigned WIDTH, unsigned HEIGHT, class PixelSetType>
+void resolveContext(const AccumulationContext<WIDTH, HEIGHT> &src, CustomDrawingContext<WIDTH, HEIGHT, CRGB, PixelSetType> &dst, uint8_t *residuals) {
+  if (src.isBlack()) {
+    memset(residuals, 0, 3 * WIDTH * HEIGHT);
+    dst.clear();
+    return;
+  }
+  for (unsigned i = 0; i < WIDTH * HEIGHT; ++i, residuals += 3) {
+    for (uint8_t c = 0; c < 3; ++c) {
+      dst.leds[i][c] = ditherChannel(src.leds[i].raw[c], residuals[c]);
+    }
+  }
+  dst.markDirty();
+}
+
 #endif
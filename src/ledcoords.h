@@ -0,0 +1,111 @@
+#ifndef LEDCOORDS_H
+#define LEDCOORDS_H
+
+// Generated by board/ledcoords.py from earthvenusmars.kicad_pcb, don't edit by hand.
+
+#include <stdint.h>
+
+// Position of an LED relative to the center of the circle. x and y run -127..127 across the farthest LED from the center,
+// with y pointing down the board as in KiCad. angle is a fraction of a turn out of 256 measured clockwise from +x,
+// and radius runs 0..255 out to the farthest LED.
+struct LEDCoord {
+  int8_t x, y;
+  uint8_t angle;
+  uint8_t radius;
+};
+
+// microns per x/y unit
+const uint16_t kLEDCoordScaleMicrons = 378;
+
+constexpr LEDCoord kLEDCoords[78] = {
+  { -10,   52,  72, 106}, // D1
+  { -19,   49,  79, 106}, // D2
+  { -28,   45,  87, 106}, // D3
+  { -36,   39,  94, 106}, // D4
+  { -42,   32, 102, 106}, // D5
+  { -47,   24, 109, 106}, // D6
+  { -51,   14, 117, 106}, // D7
+  { -53,    5, 124, 106}, // D8
+  { -53,   -5, 132, 106}, // D9
+  { -51,  -14, 139, 106}, // D10
+  { -47,  -24, 147, 106}, // D11
+  { -42,  -32, 154, 106}, // D12
+  { -44,  -44, 160, 125}, // D13
+  { -51,  -51, 160, 143}, // D14
+  { -57,  -57, 160, 162}, // D15
+  { -64,  -64, 160, 181}, // D16
+  { -70,  -70, 160, 199}, // D17
+  { -77,  -77, 160, 218}, // D18
+  { -83,  -83, 160, 236}, // D19
+  { -90,  -90, 160, 255}, // D20
+  { -92,  -79, 157, 243}, // D21
+  { -92,  -69, 154, 231}, // D22
+  { -92,  -60, 152, 220}, // D23
+  { -60,  -92, 168, 220}, // D24
+  { -69,  -92, 166, 231}, // D25
+  { -79,  -92, 163, 243}, // D26
+  { -44,  -70, 169, 166}, // D27
+  { -51,  -64, 165, 163}, // D28
+  { -64,  -51, 155, 163}, // D29
+  { -70,  -44, 151, 166}, // D30
+  { -36,  -39, 162, 106}, // D31
+  { -28,  -45, 169, 106}, // D32
+  { -19,  -49, 177, 106}, // D33
+  { -10,  -52, 184, 106}, // D34
+  {   0,  -53, 192, 106}, // D35
+  {  10,  -52, 200, 106}, // D36
+  {  19,  -49, 207, 106}, // D37
+  {  28,  -45, 215, 106}, // D38
+  {  36,  -39, 222, 106}, // D39
+  {  44,  -44, 224, 125}, // D40
+  {  51,  -51, 224, 143}, // D41
+  {  57,  -57, 224, 162}, // D42
+  {  64,  -64, 224, 181}, // D43
+  {  70,  -70, 224, 199}, // D44
+  {  77,  -77, 224, 218}, // D45
+  {  83,  -83, 224, 236}, // D46
+  {  90,  -90, 224, 255}, // D47
+  {  79,  -92, 221, 243}, // D48
+  {  69,  -92, 218, 231}, // D49
+  {  60,  -92, 216, 220}, // D50
+  {  92,  -60, 232, 220}, // D51
+  {  92,  -69, 230, 231}, // D52
+  {  92,  -79, 227, 243}, // D53
+  {  42,  -32, 230, 106}, // D54
+  {  47,  -24, 237, 106}, // D55
+  {  51,  -14, 245, 106}, // D56
+  {  53,   -5, 252, 106}, // D57
+  {  53,    5,   4, 106}, // D58
+  {  51,   14,  11, 106}, // D59
+  {  47,   24,  19, 106}, // D60
+  {  42,   32,  26, 106}, // D61
+  {  36,   39,  34, 106}, // D62
+  {  28,   45,  41, 106}, // D63
+  {  19,   49,  49, 106}, // D64
+  {  10,   52,  56, 106}, // D65
+  {   0,   53,  64, 106}, // D66
+  {   0,   62,  64, 125}, // D67
+  {   0,   71,  64, 143}, // D68
+  {   0,   81,  64, 162}, // D69
+  {   0,   90,  64, 181}, // D70
+  {   0,   99,  64, 199}, // D71
+  {   0,  108,  64, 218}, // D72
+  {   0,  118,  64, 236}, // D73
+  {   0,  127,  64, 255}, // D74
+  {   9,   99,  60, 200}, // D75
+  {  19,   99,  56, 203}, // D76
+  { -19,   99,  72, 203}, // D77
+  {  -9,   99,  68, 200}, // D78
+};
+
+// led indexes ordered by angle, then by radius
+constexpr uint8_t kLEDsByAngle[78] = {
+  57, 58, 59, 60, 61, 62, 63, 64, 75, 74, 65, 66, 67,
+  68, 69, 70, 71, 72, 73, 77,  0, 76,  1,  2,  3,  4,
+   5,  6,  7,  8,  9, 10, 29, 22, 11, 21, 28, 20, 12,
+  13, 14, 15, 16, 17, 18, 19, 30, 25, 27, 24, 23, 31,
+  26, 32, 33, 34, 35, 36, 37, 49, 48, 47, 38, 39, 40,
+  41, 42, 43, 44, 45, 46, 52, 53, 51, 50, 54, 55, 56,
+};
+
+#endif
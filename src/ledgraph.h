@@ -3,11 +3,13 @@
 
 #include <vector>
 #include <algorithm>
+#include <initializer_list>
+#include <type_traits>
 #include <FastLED.h>
-#include <set>
 #include <util.h>
 
 #include "drawing.h"
+#include "ledcoords.h"
 
 using namespace std;
 
@@ -21,7 +23,14 @@ typedef union {
   uint8_t pair;
 } EdgeTypesPair;
 
-struct Edge {
+// Pixel indexes fit in a byte on boards with fewer than 255 LEDs, the all-ones value is left over to mean "no pixel"
+template <unsigned LEDCount>
+using PixelIndexFor = typename std::conditional<(LEDCount < 0xFF), uint8_t, uint16_t>::type;
+
+template <typename Index>
+constexpr Index NoPixelFor = (Index)~(Index)0;
+
+struct EdgeBase {
     typedef enum : uint8_t {
         none             = 0,
         inbound          = 1 << 0,
@@ -30,24 +39,31 @@ struct Edge {
         counterclockwise = 1 << 3,
         all              = 0xFF,
     } EdgeType;
-    
-    uint8_t from, to;
-    EdgeType type;
-    Edge(uint8_t from, uint8_t to, EdgeType type) : from(from), to(to), type(type) {};
-    Edge transpose() {
-        EdgeType transposeType;
+
+    static constexpr EdgeType reverse(EdgeType type) {
         switch (type) {
-            case inbound: transposeType = outbound; break;
-            case outbound: transposeType = inbound; break;
-            case clockwise: transposeType = counterclockwise; break;
-            case counterclockwise: transposeType = clockwise; break;
-            default: transposeType = none; break;
+            case inbound: return outbound;
+            case outbound: return inbound;
+            case clockwise: return counterclockwise;
+            case counterclockwise: return clockwise;
+            default: return none;
         }
-        return Edge(to, from, transposeType);
     }
 };
 
-typedef Edge::EdgeType EdgeType;
+template <typename Index>
+struct BasicEdge : public EdgeBase {
+    Index from, to;
+    EdgeType type;
+    constexpr BasicEdge() : from(0), to(0), type(none) {};
+    constexpr BasicEdge(Index from, Index to, EdgeType type) : from(from), to(to), type(type) {};
+    constexpr BasicEdge transpose() const {
+        return BasicEdge(to, from, reverse(type));
+    }
+};
+
+typedef BasicEdge<uint8_t> Edge;
+typedef EdgeBase::EdgeType EdgeType;
 typedef uint8_t EdgeTypes;
 
 EdgeTypesPair MakeEdgeTypesPair(vector<EdgeTypes> vec) {
@@ -63,48 +79,299 @@ EdgeTypesPair MakeEdgeTypesPair(vector<EdgeTypes> vec) {
     return pair;
 }
 
-class Graph {
+// pixel index meaning "none" on this board, outside any layout PixelMask can hold
+const uint8_t NoPixel = NoPixelFor<uint8_t>;
+
+// Read-only view of a constant array of pixel indexes, so region lists can live in flash instead of heap vectors
+template <typename Index>
+class BasicPixelList {
+    const Index *pixels;
+    Index count;
 public:
-    vector<vector<Edge> > adjList;
-    Graph() { }
-    Graph(vector<Edge> const &edges, int count) {
-        adjList.resize(count);
+    template <unsigned N>
+    constexpr BasicPixelList(const Index (&pixels)[N]) : pixels(pixels), count(N) { }
+
+    constexpr Index size() const { return count; }
+    constexpr Index operator[](Index i) const { return pixels[i]; }
+    constexpr const Index *begin() const { return pixels; }
+    constexpr const Index *end() const { return pixels + count; }
+};
+
+typedef BasicPixelList<uint8_t> PixelList;
 
-        for (auto &edge : edges) {
-            addEdge(edge);
+// Set of pixel indices on a board of LEDCount pixels as a bitmask, one bit per pixel. Mirrors the parts of std::set<uint8_t> we used.
+template <unsigned LEDCount>
+class BasicPixelMask {
+public:
+    typedef PixelIndexFor<LEDCount> Index;
+    static const uint8_t WordCount = (LEDCount + 31) / 32;
+    static const unsigned Capacity = 32 * WordCount;
+private:
+    uint32_t words[WordCount];
+public:
+    constexpr BasicPixelMask() : words{} { }
+    constexpr BasicPixelMask(std::initializer_list<Index> pixels) : words{} {
+        for (Index px : pixels) {
+            words[px >> 5] |= 1u << (px & 31);
         }
     }
 
-    void addEdge(Edge edge, bool bidirectional=true) {
-        adjList[edge.from].push_back(edge);
-        if (bidirectional) {
-            adjList[edge.to].push_back(edge.transpose());
+    constexpr BasicPixelMask(const BasicPixelList<Index> &pixels) : words{} {
+        for (Index px : pixels) {
+            words[px >> 5] |= 1u << (px & 31);
         }
     }
 
-    vector<Edge> adjacencies(uint8_t vertex, EdgeTypesPair pair) {
-        vector<Edge> adjList;
-        getAdjacencies(vertex, pair.edgeTypes.first, adjList);
-        getAdjacencies(vertex, pair.edgeTypes.second, adjList);
-        return adjList;
+    // raw bits for the 32 pixels from 32 * w, for code that works through many pixels at once
+    inline constexpr uint32_t word(uint8_t w) const {
+        return words[w];
+    }
+
+    inline constexpr bool contains(Index px) const {
+        return words[px >> 5] & (1u << (px & 31));
+    }
+
+    inline void insert(Index px) {
+        words[px >> 5] |= 1u << (px & 31);
+    }
+
+    inline void erase(Index px) {
+        words[px >> 5] &= ~(1u << (px & 31));
     }
 
-    void getAdjacencies(uint8_t vertex, EdgeTypes matching, std::vector<Edge> &insertInto) {
-        if (matching == 0) {
-            return;
+    inline void clear() {
+        for (uint8_t w = 0; w < WordCount; ++w) words[w] = 0;
+    }
+
+    bool empty() const {
+        uint32_t any = 0;
+        for (uint8_t w = 0; w < WordCount; ++w) any |= words[w];
+        return any == 0;
+    }
+
+    Index size() const {
+        Index count = 0;
+        for (uint8_t w = 0; w < WordCount; ++w) {
+            count += __builtin_popcount(words[w]);
         }
-        vector<Edge> &adj = adjList[vertex];
-        for (Edge &edge : adj) {
-            if (edge.type & matching) {
-                insertInto.push_back(edge);
+        return count;
+    }
+
+    // the nth pixel in the mask, in index order
+    Index nth(Index n) const {
+        for (uint8_t w = 0; w < WordCount; ++w) {
+            uint32_t word = words[w];
+            uint8_t count = __builtin_popcount(word);
+            if (n < count) {
+                while (n--) {
+                    word &= word - 1;
+                }
+                return 32 * w + __builtin_ctz(word);
             }
+            n -= count;
         }
+        return NoPixelFor<Index>;
+    }
+
+    constexpr BasicPixelMask operator|(const BasicPixelMask &other) const {
+        BasicPixelMask result;
+        for (uint8_t w = 0; w < WordCount; ++w) result.words[w] = words[w] | other.words[w];
+        return result;
+    }
+
+    constexpr BasicPixelMask operator&(const BasicPixelMask &other) const {
+        BasicPixelMask result;
+        for (uint8_t w = 0; w < WordCount; ++w) result.words[w] = words[w] & other.words[w];
+        return result;
     }
+
+    BasicPixelMask &operator|=(const BasicPixelMask &other) {
+        for (uint8_t w = 0; w < WordCount; ++w) words[w] |= other.words[w];
+        return *this;
+    }
+
+    BasicPixelMask &operator&=(const BasicPixelMask &other) {
+        for (uint8_t w = 0; w < WordCount; ++w) words[w] &= other.words[w];
+        return *this;
+    }
+
+    constexpr bool operator==(const BasicPixelMask &other) const {
+        for (uint8_t w = 0; w < WordCount; ++w) {
+            if (words[w] != other.words[w]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // iterates the pixels in the mask in index order
+    class iterator {
+        const BasicPixelMask &mask;
+        uint8_t word;
+        uint32_t remaining;
+        void skipEmptyWords() {
+            while (remaining == 0 && word < WordCount) {
+                if (++word < WordCount) {
+                    remaining = mask.words[word];
+                }
+            }
+        }
+    public:
+        iterator(const BasicPixelMask &mask, uint8_t word) : mask(mask), word(word), remaining(word < WordCount ? mask.words[word] : 0) {
+            skipEmptyWords();
+        }
+        inline Index operator*() const { return 32 * word + __builtin_ctz(remaining); }
+        iterator &operator++() {
+            remaining &= remaining - 1;
+            skipEmptyWords();
+            return *this;
+        }
+        inline bool operator!=(const iterator &other) const { return word != other.word || remaining != other.remaining; }
+    };
+
+    iterator begin() const { return iterator(*this, 0); }
+    iterator end() const { return iterator(*this, WordCount); }
 };
 
 #define NUM_LEDS (78)
 
-Graph ledgraph;
+typedef BasicPixelMask<NUM_LEDS> PixelMask;
+
+// no pixel in this design has more than 4 adjacencies
+const uint8_t MaxAdjacencies = 4;
+
+// small fixed list of neighboring pixels, filled in place so lookups don't allocate
+template <typename Index>
+struct BasicNextHops {
+    uint8_t count = 0;
+    Index px[MaxAdjacencies];
+    EdgeType types[MaxAdjacencies];
+
+    inline void add(Index to, EdgeType type) {
+        px[count] = to;
+        types[count] = type;
+        ++count;
+    }
+
+    inline bool contains(Index to) const {
+        for (uint8_t i = 0; i < count; ++i) {
+            if (px[i] == to) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+typedef BasicNextHops<uint8_t> NextHops;
+
+// one directed edge out of a vertex in a CSRGraph
+template <typename Index>
+struct GraphHop {
+    Index to;
+    EdgeType type;
+};
+
+// Adjacency as compressed sparse rows: vertex v's edges are hops[offsets[v]] up to hops[offsets[v+1]].
+// Built at compile time by MakeCSRGraph so it lives in flash and needs no setup.
+template <unsigned VertexCount_, unsigned EdgeCount>
+struct CSRGraph {
+    static const unsigned VertexCount = VertexCount_;
+    typedef PixelIndexFor<VertexCount> Index;
+    typedef BasicEdge<Index> Edge;
+    typedef GraphHop<Index> Hop;
+    typedef typename std::conditional<(2 * EdgeCount <= 0xFF), uint8_t, uint16_t>::type Offset;
+
+    Offset offsets[VertexCount + 1];
+    Hop hops[2 * EdgeCount]; // every edge is stored from both ends
+
+    constexpr uint8_t degree(Index vertex) const {
+        return offsets[vertex + 1] - offsets[vertex];
+    }
+
+    constexpr uint8_t maxDegree() const {
+        uint8_t most = 0;
+        for (unsigned v = 0; v < VertexCount; ++v) {
+            most = MAX(most, degree(v));
+        }
+        return most;
+    }
+
+    // A vertex's edges matching any of the given types, as Edges out of the vertex. Reverse directions of edges
+    // are already in the table, so this covers edges that were declared pointing into the vertex too.
+    class EdgeRange {
+        const Hop *first, *last;
+        Index from;
+        EdgeTypes matching;
+    public:
+        class iterator {
+            const Hop *hop, *last;
+            Index from;
+            EdgeTypes matching;
+            constexpr void skipUnmatched() {
+                while (hop != last && !(hop->type & matching)) {
+                    ++hop;
+                }
+            }
+        public:
+            constexpr iterator(const Hop *hop, const Hop *last, Index from, EdgeTypes matching) : hop(hop), last(last), from(from), matching(matching) {
+                skipUnmatched();
+            }
+            constexpr Edge operator*() const { return Edge(from, hop->to, hop->type); }
+            constexpr iterator &operator++() { ++hop; skipUnmatched(); return *this; }
+            constexpr bool operator!=(const iterator &other) const { return hop != other.hop; }
+        };
+
+        constexpr EdgeRange(const Hop *first, const Hop *last, Index from, EdgeTypes matching) : first(first), last(last), from(from), matching(matching) { }
+        constexpr iterator begin() const { return iterator(first, last, from, matching); }
+        constexpr iterator end() const { return iterator(last, last, from, matching); }
+    };
+
+    constexpr EdgeRange edges(Index vertex, EdgeTypes matching=EdgeType::all) const {
+        return EdgeRange(hops + offsets[vertex], hops + offsets[vertex + 1], vertex, matching);
+    }
+
+    // the vertex's neighbors along edges matching either half of pair, first's matches first
+    void nextHops(Index vertex, EdgeTypesPair pair, BasicNextHops<Index> &into) const {
+        into.count = 0;
+        appendHops(vertex, pair.edgeTypes.first, into);
+        appendHops(vertex, pair.edgeTypes.second, into);
+    }
+
+private:
+    inline void appendHops(Index vertex, EdgeTypes matching, BasicNextHops<Index> &into) const {
+        for (Edge edge : edges(vertex, matching)) {
+            if (into.count == MaxAdjacencies) {
+                break;
+            }
+            into.add(edge.to, edge.type);
+        }
+    }
+};
+
+// Each vertex lists its edges in the order they appear in edges, the reverse direction of an edge included.
+// Counts degrees and then fills each vertex's row, so it stays linear in the size of the graph for big boards.
+template <unsigned VertexCount, unsigned EdgeCount, typename Index>
+constexpr CSRGraph<VertexCount, EdgeCount> MakeCSRGraph(const BasicEdge<Index> (&edges)[EdgeCount]) {
+    static_assert(std::is_same<Index, PixelIndexFor<VertexCount>>::value, "edge index type doesn't match the vertex count");
+    CSRGraph<VertexCount, EdgeCount> graph = {};
+    unsigned next[VertexCount + 1] = {};
+    for (const BasicEdge<Index> &edge : edges) {
+        ++next[edge.from + 1];
+        ++next[edge.to + 1];
+    }
+    for (unsigned v = 0; v < VertexCount; ++v) {
+        next[v + 1] += next[v];
+        graph.offsets[v] = next[v];
+    }
+    graph.offsets[VertexCount] = next[VertexCount];
+    for (const BasicEdge<Index> &edge : edges) {
+        graph.hops[next[edge.from]++] = {edge.to, edge.type};
+        BasicEdge<Index> transposed = edge.transpose();
+        graph.hops[next[edge.to]++] = {transposed.to, transposed.type};
+    }
+    return graph;
+}
 
 #define CIRCLE_LEDS 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 30, 31, 32, 33, 34, 35, 36, 37, 38, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64, 65 // 34
 
@@ -112,51 +379,131 @@ Graph ledgraph;
 #define VENUS_LEDS 66, 67, 68, 69, 70, 71, 72, 73, 77, 76, 74, 75 // 12
 #define MARS_LEDS 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 52, 51, 50 // 14
 
-const vector<uint8_t> circleleds = {CIRCLE_LEDS};
-const vector<uint8_t> leafleds = {22, 23, 29, 26, 49, 50, 76, 75, 73};
-const vector<uint8_t> spoke_tip_leds = {19, 46, 73};
-const vector<uint8_t> spoke_base_leds = {12, 39, 68};
+constexpr uint8_t kCircleLeds[] = {CIRCLE_LEDS};
+constexpr uint8_t kLeafLeds[] = {22, 23, 29, 26, 49, 50, 76, 75, 73};
+constexpr uint8_t kSpokeTipLeds[] = {19, 46, 73};
+constexpr uint8_t kSpokeBaseLeds[] = {12, 39, 68};
+constexpr uint8_t kEarthLeds[] = {EARTH_LEDS};
+constexpr uint8_t kVenusLeds[] = {VENUS_LEDS};
+constexpr uint8_t kMarsLeds[] = {MARS_LEDS};
+constexpr uint8_t kEarthAsVenusLeds[] = {12, 13, 14, 15, 16, 17, 18, 19, 28, 29, 27, 26}; // 12
+constexpr uint8_t kEarthAsMarsLeds[] = {12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 25, 24, 23}; // 14
+// just the pixels on the arrow or cross on the earth spoke
+constexpr uint8_t kEarthVenusOnly[] = {28, 29, 27, 26};
+constexpr uint8_t kEarthMarsOnly[] = {20, 21, 22, 25, 24, 23};
+
+constexpr PixelList circleleds = kCircleLeds;
+constexpr PixelList leafleds = kLeafLeds;
+constexpr PixelList spoke_tip_leds = kSpokeTipLeds;
+constexpr PixelList spoke_base_leds = kSpokeBaseLeds;
+
+constexpr PixelList venusleds = kVenusLeds;
+constexpr PixelList marsleds = kMarsLeds;
+
+constexpr PixelList earthleds = kEarthLeds;
+constexpr PixelList earthasvenusleds = kEarthAsVenusLeds;
+constexpr PixelList earthasmarsleds = kEarthAsMarsLeds;
+
+// The parts of the design as masks for fast membership tests, e.g. restricting where bits can travel or spawn. These are
+// EVMLayout's regions, the *LedsMask names below are shorthands for them.
+struct EVMRegions {
+    PixelMask circle;
+    PixelMask leaves; // ends of the arrows and crosses
+    PixelMask earth, venus, mars;
+    PixelMask earthAsVenus, earthAsMars; // the earth spoke with only its cross, or only its arrow
+    PixelMask spokes; // all three
+};
 
-const vector<uint8_t> venusleds = {VENUS_LEDS};
-const vector<uint8_t> marsleds = {MARS_LEDS};
+inline constexpr EVMRegions kEVMRegions = {
+    circleleds, leafleds, earthleds, venusleds, marsleds, earthasvenusleds, earthasmarsleds,
+    PixelMask(earthleds) | PixelMask(venusleds) | PixelMask(marsleds),
+};
 
-const vector<uint8_t> earthleds = {EARTH_LEDS};
-const vector<uint8_t> earthasvenusleds = {12, 13, 14, 15, 16, 17, 18, 19, 28, 29, 27, 26}; // 12
-const vector<uint8_t> earthasmarsleds = {12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 25, 24, 23}; // 14
+constexpr const PixelMask &circleLedsMask = kEVMRegions.circle;
+constexpr const PixelMask &leafLedsMask = kEVMRegions.leaves;
+constexpr const PixelMask &earthLedsMask = kEVMRegions.earth;
+constexpr const PixelMask &venusLedsMask = kEVMRegions.venus;
+constexpr const PixelMask &marsLedsMask = kEVMRegions.mars;
+constexpr const PixelMask &earthAsVenusLedsMask = kEVMRegions.earthAsVenus;
+constexpr const PixelMask &earthAsMarsLedsMask = kEVMRegions.earthAsMars;
+constexpr const PixelMask &spokeLedsMask = kEVMRegions.spokes;
 
-// FIXME: make these vectors? I expect the asymptotic win from searching a ~50-element std::set is not enough to counter the constant from following pointers + the increased memory usage
-const set<uint8_t> circleEarthLeds = {CIRCLE_LEDS, EARTH_LEDS};
-const set<uint8_t> circleVenusLeds = {CIRCLE_LEDS, VENUS_LEDS};
-const set<uint8_t> circleMarsLeds = {CIRCLE_LEDS, MARS_LEDS};
+constexpr PixelMask circleEarthLeds = circleLedsMask | earthLedsMask;
+constexpr PixelMask circleVenusLeds = circleLedsMask | venusLedsMask;
+constexpr PixelMask circleMarsLeds = circleLedsMask | marsLedsMask;
 
 // just the pixels on the arrow or cross on the earth spoke
-const vector<uint8_t> earthVenusOnly = {28, 29, 27, 26};
-const vector<uint8_t> earthMarsOnly = {20, 21, 22, 25, 24, 23};
+constexpr PixelList earthVenusOnly = kEarthVenusOnly;
+constexpr PixelList earthMarsOnly = kEarthMarsOnly;
 
 // indexes into circleleds vector opposite each spoke for use in pathing
 const uint8_t circleIndexOppositeEarth = 29;
 const uint8_t circleIndexOppositeVenus = 16;
 const uint8_t circleIndexOppositeMars = 3;
 
-static const set<uint8_t> *const kSpokeCircleLedSets[] = {&circleEarthLeds, &circleVenusLeds, &circleMarsLeds};
-static const vector<uint8_t> * const kSpokeLedLists[] = {&earthleds, &venusleds, &marsleds};
+// the circle pixel each spoke branches off of, earth/venus/mars
+constexpr uint8_t kSpokeJunctionLeds[] = {30, 65, 38};
 
+constexpr const PixelMask *kSpokeCircleLedMasks[] = {&circleEarthLeds, &circleVenusLeds, &circleMarsLeds};
+constexpr PixelList kSpokeLedLists[] = {earthleds, venusleds, marsleds};
 
-// shortcuts for quickly determined if a pixel is in a given spoke
-bool onEarth(uint8_t px) {
-    return px >= 12 && px <= 29;
+
+static_assert(ARRAY_SIZE(kLEDCoords) == NUM_LEDS, "regenerate ledcoords.h with board/ledcoords.py");
+
+// how far apart two LEDCoord angles are, either way around
+inline uint8_t angleDistance(uint8_t a, uint8_t b) {
+    uint8_t d = a - b;
+    return MIN(d, (uint8_t)(0x100 - d));
+}
+
+// pixels within radius of (x, y), all in LEDCoord x/y units
+PixelMask pixelsWithin(int8_t x, int8_t y, uint8_t radius) {
+    PixelMask pixels;
+    const int r2 = radius * radius;
+    for (uint8_t i = 0; i < NUM_LEDS; ++i) {
+        int dx = kLEDCoords[i].x - x;
+        int dy = kLEDCoords[i].y - y;
+        if (dx * dx + dy * dy <= r2) {
+            pixels.insert(i);
+        }
+    }
+    return pixels;
 }
 
-bool onVenus(uint8_t px) {
-    return px >= 66 && px <= 77;
+// pixels between minRadius and maxRadius from the center of the circle, inclusive, in LEDCoord radius units
+PixelMask pixelsInRing(uint8_t minRadius, uint8_t maxRadius) {
+    PixelMask pixels;
+    for (uint8_t i = 0; i < NUM_LEDS; ++i) {
+        if (kLEDCoords[i].radius >= minRadius && kLEDCoords[i].radius <= maxRadius) {
+            pixels.insert(i);
+        }
+    }
+    return pixels;
 }
 
-bool onMars(uint8_t px) {
-    return px >= 39 && px <= 52;
+// pixels in the wedge running clockwise from start for width, in LEDCoord angle units
+PixelMask pixelsInArc(uint8_t start, uint8_t width) {
+    PixelMask pixels;
+    for (uint8_t i = 0; i < NUM_LEDS; ++i) {
+        if ((uint8_t)(kLEDCoords[i].angle - start) <= width) {
+            pixels.insert(i);
+        }
+    }
+    return pixels;
 }
 
-void initLEDGraph() {
-    vector<Edge> edges = {
+
+// 23 hand-placed edges, the circle, and 7 edges down each spoke
+const unsigned kLEDEdgeCount = 23 + ARRAY_SIZE(kCircleLeds) + 3 * 7;
+
+struct LEDEdgeList {
+    Edge edges[kLEDEdgeCount];
+};
+
+constexpr LEDEdgeList MakeLEDEdges() {
+    LEDEdgeList list = {};
+    unsigned n = 0;
+    const Edge placed[] = {
         // spoke connections
         {30, 12, Edge::outbound}, {38, 39, Edge::outbound}, {65,66, Edge::outbound},
 
@@ -176,28 +523,217 @@ void initLEDGraph() {
         {70, 77, Edge::outbound}, {77, 76, Edge::outbound},
         {70, 74, Edge::outbound}, {74, 75, Edge::outbound},
     };
-
-    ledgraph = Graph(edges, NUM_LEDS);
+    for (const Edge &edge : placed) {
+        list.edges[n++] = edge;
+    }
 
     // circle is pixels D1-D12, D31-D39, D54-D66
     // e.g. leds[] 0-11, 30-38, 53-65
-    for (unsigned i = 0; i < circleleds.size(); ++i) {
-        ledgraph.addEdge(Edge(circleleds[i], circleleds[mod_wrap(i+1, circleleds.size())], Edge::clockwise));
+    for (unsigned i = 0; i < ARRAY_SIZE(kCircleLeds); ++i) {
+        list.edges[n++] = Edge(kCircleLeds[i], kCircleLeds[(i+1) % ARRAY_SIZE(kCircleLeds)], Edge::clockwise);
     }
 
     // spokes are D13-D20, D40-D47, D67-D74
     // e.g. leds[] 12-19, 39-46, 66-73
-    for (uint8_t i = 12; i < 19; ++i) {
-        ledgraph.addEdge(Edge(i, i+1, Edge::outbound));
+    const uint8_t spokeBases[] = {12, 39, 66};
+    for (uint8_t base : spokeBases) {
+        for (uint8_t i = base; i < base + 7; ++i) {
+            list.edges[n++] = Edge(i, i+1, Edge::outbound);
+        }
     }
-    for (uint8_t i = 39; i < 46; ++i) {
-        ledgraph.addEdge(Edge(i, i+1, Edge::outbound));
+    return list;
+}
+
+constexpr LEDEdgeList kLEDEdges = MakeLEDEdges();
+// inline for external linkage, so the graph can parameterize EVMLayout without tying it to this translation unit
+inline constexpr CSRGraph<NUM_LEDS, kLEDEdgeCount> ledgraph = MakeCSRGraph<NUM_LEDS>(kLEDEdges.edges);
+static_assert(ledgraph.offsets[NUM_LEDS] == 2 * kLEDEdgeCount, "every edge should appear once from each end");
+
+// regions for boards whose pixels are all alike, like a strip or ring
+struct NoRegions { };
+inline constexpr NoRegions kNoRegions = {};
+
+// Everything the drawing contexts and bits engine need to know about a board: how many LEDs it has, how they're
+// connected, and its named regions of pixels (a struct of masks, e.g. EVMRegions). Other boards describe themselves the
+// same way, e.g. a strip or ring from MakeStripEdges, and reuse the engine.
+template <unsigned LEDCount_, class GraphType, const GraphType &Graph, class RegionsType = NoRegions, const RegionsType &Regions = kNoRegions>
+struct BoardLayout {
+    static const unsigned LEDCount = LEDCount_;
+    static_assert(GraphType::VertexCount == LEDCount, "the graph needs a vertex for every LED");
+    // CSRGraph::nextHops stops at MaxAdjacencies, so a busier pixel would quietly lose neighbors
+    static_assert(Graph.maxDegree() <= MaxAdjacencies, "NextHops can't hold every adjacency");
+
+    typedef typename GraphType::Index PixelIndex;
+    typedef BasicPixelMask<LEDCount> PixelMask;
+    typedef BasicNextHops<PixelIndex> NextHops;
+    static constexpr PixelIndex NoPixel = NoPixelFor<PixelIndex>;
+    static constexpr const GraphType &graph = Graph;
+    static constexpr const RegionsType &regions = Regions;
+};
+
+typedef BoardLayout<NUM_LEDS, CSRGraph<NUM_LEDS, kLEDEdgeCount>, ledgraph, EVMRegions, kEVMRegions> EVMLayout;
+
+// Edges for LEDCount pixels wired in a line, outbound from pixel 0. A ring also joins the last pixel back to the first
+// and runs clockwise instead.
+template <unsigned LEDCount, bool Ring>
+struct StripEdgeList {
+    static const unsigned EdgeCount = Ring ? LEDCount : LEDCount - 1;
+    BasicEdge<PixelIndexFor<LEDCount>> edges[EdgeCount];
+};
+
+template <unsigned LEDCount, bool Ring>
+constexpr StripEdgeList<LEDCount, Ring> MakeStripEdges() {
+    typedef BasicEdge<PixelIndexFor<LEDCount>> StripEdge;
+    StripEdgeList<LEDCount, Ring> list = {};
+    for (unsigned i = 0; i < StripEdgeList<LEDCount, Ring>::EdgeCount; ++i) {
+        list.edges[i] = StripEdge(i, (i + 1) % LEDCount, Ring ? StripEdge::clockwise : StripEdge::outbound);
     }
-    for (uint8_t i = 66; i < 73; ++i) {
-        ledgraph.addEdge(Edge(i, i+1, Edge::outbound));
+    return list;
+}
+
+// hop count meaning "can't get there"
+const uint8_t NoPath = 0xFF;
+
+// All-pairs hop counts over a graph, following only edges of the matching types. Distances past 254 hops read as NoPath.
+template <unsigned VertexCount>
+struct HopDistances {
+    typedef PixelIndexFor<VertexCount> Index;
+    uint8_t hops[VertexCount][VertexCount];
+
+    constexpr uint8_t distance(Index from, Index to) const {
+        return hops[from][to];
     }
+
+    // hops from source to every vertex, for ripple and wave effects that shade each pixel by its distance
+    constexpr const uint8_t *fromSource(Index source) const {
+        return hops[source];
+    }
+
+    // the closest vertex in targets reachable from source, or NoPixel if none is
+    Index nearest(Index source, const BasicPixelMask<VertexCount> &targets, uint8_t *distanceOut=NULL) const {
+        Index best = NoPixelFor<Index>;
+        uint8_t bestDistance = NoPath;
+        for (Index target : targets) {
+            if (hops[source][target] < bestDistance) {
+                best = target;
+                bestDistance = hops[source][target];
+            }
+        }
+        if (distanceOut) {
+            *distanceOut = bestDistance;
+        }
+        return best;
+    }
+
+    // hops from source to the closest vertex in targets, NoPath if none is reachable
+    uint8_t distanceTo(Index source, const BasicPixelMask<VertexCount> &targets) const {
+        uint8_t distance;
+        nearest(source, targets, &distance);
+        return distance;
+    }
+};
+
+// breadth-first search out of every vertex
+template <unsigned VertexCount, unsigned EdgeCount>
+constexpr HopDistances<VertexCount> MakeHopDistances(const CSRGraph<VertexCount, EdgeCount> &graph, EdgeTypes matching) {
+    HopDistances<VertexCount> distances = {};
+    for (unsigned source = 0; source < VertexCount; ++source) {
+        uint8_t *row = distances.hops[source];
+        for (unsigned v = 0; v < VertexCount; ++v) {
+            row[v] = NoPath;
+        }
+        typename CSRGraph<VertexCount, EdgeCount>::Index queue[VertexCount] = {};
+        unsigned head = 0, tail = 0;
+        row[source] = 0;
+        queue[tail++] = source;
+        while (head < tail) {
+            auto v = queue[head++];
+            for (auto edge : graph.edges(v, matching)) {
+                if (row[edge.to] == NoPath && row[v] + 1 < NoPath) {
+                    row[edge.to] = row[v] + 1;
+                    queue[tail++] = edge.to;
+                }
+            }
+        }
+    }
+    return distances;
+}
+
+// Hop distances over ledgraph along the given edge types, e.g. EdgeType::clockwise for distances around the circle in
+// one direction. Each table is 6KB of flash and is only emitted for the edge types that are actually used.
+template <EdgeTypes Matching>
+struct LEDHopDistances {
+    static constexpr HopDistances<NUM_LEDS> table = MakeHopDistances(ledgraph, Matching);
+};
+
+template <EdgeTypes Matching = EdgeType::all>
+inline const HopDistances<NUM_LEDS> &hopDistances() {
+    return LEDHopDistances<Matching>::table;
+}
+
+// spoke number meaning "on the circle"
+const uint8_t NoSpoke = 0xFF;
+
+// Where a pixel sits in the design
+struct PixelInfo {
+    typedef enum : uint8_t { circle, earth, venus, mars } Region;
+    typedef enum : uint8_t {
+        leaf = 1 << 0, // end of an arrow or cross
+        tip  = 1 << 1, // end of the spoke's straight run
+    } Flags;
+
+    Region region;
+    uint8_t ringIndex; // index into circleleds, NoPixel off the circle
+    uint8_t spoke; // index into kSpokeLedLists, NoSpoke on the circle
+    uint8_t depth; // hops out from the circle along the spoke, 0 on the circle
+    uint8_t flags;
+};
+
+struct PixelInfoTable {
+    PixelInfo pixels[NUM_LEDS];
+};
+
+constexpr PixelInfoTable MakePixelInfoTable() {
+    PixelInfoTable table = {};
+    for (uint8_t i = 0; i < circleleds.size(); ++i) {
+        table.pixels[circleleds[i]] = {PixelInfo::circle, i, NoSpoke, 0, 0};
+    }
+    const HopDistances<NUM_LEDS> outbound = MakeHopDistances(ledgraph, EdgeType::outbound);
+    for (uint8_t spoke = 0; spoke < ARRAY_SIZE(kSpokeLedLists); ++spoke) {
+        for (uint8_t px : kSpokeLedLists[spoke]) {
+            uint8_t depth = outbound.distance(kSpokeJunctionLeds[spoke], px);
+            table.pixels[px] = {(PixelInfo::Region)(PixelInfo::earth + spoke), NoPixel, spoke, depth, 0};
+        }
+    }
+    for (uint8_t px : leafleds) {
+        table.pixels[px].flags |= PixelInfo::leaf;
+    }
+    for (uint8_t px : spoke_tip_leds) {
+        table.pixels[px].flags |= PixelInfo::tip;
+    }
+    return table;
+}
+
+constexpr PixelInfoTable kPixelInfo = MakePixelInfoTable();
+
+inline const PixelInfo &pixelInfo(uint8_t px) {
+    return kPixelInfo.pixels[px];
+}
+
+// shortcuts for quickly determined if a pixel is in a given spoke
+inline bool onEarth(uint8_t px) {
+    return pixelInfo(px).region == PixelInfo::earth;
+}
+
+inline bool onVenus(uint8_t px) {
+    return pixelInfo(px).region == PixelInfo::venus;
+}
+
+inline bool onMars(uint8_t px) {
+    return pixelInfo(px).region == PixelInfo::mars;
 }
 
-typedef CustomDrawingContext<NUM_LEDS, 1, CRGB, CRGBArray<NUM_LEDS> > EVMDrawingContext;
+typedef LayoutDrawingContext<EVMLayout> EVMDrawingContext;
+typedef LayoutAccumulationContext<EVMLayout> EVMAccumulationContext;
 
 #endif
@@ -0,0 +1,345 @@
+#ifndef LEDOUTPUT_H
+#define LEDOUTPUT_H
+
+#include <FastLED.h>
+#include <functional>
+#include <vector>
+#include "util.h"
+#include "config.h"
+#include "drawing.h"
+#include "ledgraph.h"
+
+#ifdef ARDUINO_ARCH_SAMD
+#include <SPI.h>
+#endif
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "frames are packed as little-endian words");
+
+constexpr double ConstexprLog(double x) {
+  // x = m * 2^e with m in [0.5, 1), then ln m from the atanh series, which converges quickly there
+  int e = 0;
+  while (x >= 1) {
+    x /= 2;
+    ++e;
+  }
+  while (x < 0.5) {
+    x *= 2;
+    --e;
+  }
+  const double z = (x - 1) / (x + 1);
+  double term = z, sum = 0;
+  for (int n = 1; n < 40; n += 2) {
+    sum += term / n;
+    term *= z * z;
+  }
+  return 2 * sum + e * 0.6931471805599453;
+}
+
+constexpr double ConstexprExp(double x) {
+  // exp(x / 1024)^1024, the series is short that close to 0
+  x /= 1024;
+  double term = 1, sum = 1;
+  for (int n = 1; n < 12; ++n) {
+    term *= x / n;
+    sum += term;
+  }
+  for (uint8_t i = 0; i < 10; ++i) {
+    sum *= sum;
+  }
+  return sum;
+}
+
+// One color channel's response: out = correction / 255 * in^gamma, with in and out running 0-1.
+struct ChannelCurve {
+  double gamma;
+  uint8_t correction; // the channel's full scale, for white balance
+};
+
+// Output-stage curves for each color channel as tables of 8.8 fixed point values at every whole input step,
+// interpolated in between so 8.8 inputs keep their fractions. The last entry is for inputs past 0xFF00.
+// Built at compile time with MakeOutputCurves.
+struct OutputCurves {
+  uint16_t tables[3][257]; // r, g, b
+
+  // an 8.8 value of channel c through its curve
+  inline uint16_t apply(uint8_t c, uint16_t value) const {
+    const uint16_t *table = tables[c];
+    const uint8_t step = value >> 8;
+    return table[step] + (((uint32_t)(table[step + 1] - table[step]) * (value & 0xFF)) >> 8);
+  }
+
+  // whether every channel is linear at full scale, so apply() leaves values up to 0xFF00 as they are
+  constexpr bool isIdentity() const {
+    for (uint8_t c = 0; c < 3; ++c) {
+      for (uint16_t step = 0; step < 256; ++step) {
+        if (tables[c][step] != step << 8) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+};
+
+constexpr OutputCurves MakeOutputCurves(ChannelCurve r, ChannelCurve g, ChannelCurve b) {
+  OutputCurves curves = {};
+  const ChannelCurve channels[3] = {r, g, b};
+  for (uint8_t c = 0; c < 3; ++c) {
+    for (uint16_t step = 1; step <= 256; ++step) {
+      const double in = step / 255.;
+      const double out = channels[c].gamma == 1 ? in : ConstexprExp(channels[c].gamma * ConstexprLog(in));
+      const double value = out * channels[c].correction * 0x100 + 0.5;
+      curves.tables[c][step] = value > 0xFFFF ? 0xFFFF : (uint16_t)value;
+    }
+  }
+  return curves;
+}
+
+// Average current draw of one LED: idle, plus each channel's full-scale current times its duty, which is the channel
+// value out of 255 times the 5-bit global brightness out of 31.
+struct LEDCurrentModel {
+  uint16_t idleMicroamps;
+  uint16_t channelMicroamps[3]; // r, g, b
+};
+
+// The APA102/SK9822 byte stream: a zero start frame, then (0xE0 | 5-bit brightness), blue, green, red for each LED,
+// then an end frame to clock the data through to the last LEDs. APA102s want ones in the end frame, SK9822s zeros.
+template <ESPIChipsets Chipset, unsigned LEDCount>
+struct APA102Frame {
+  static const unsigned StartBytes = 4;
+  static const unsigned EndBytes = 4 * (LEDCount / 32 + 1);
+  static const unsigned Size = StartBytes + 4 * LEDCount + EndBytes;
+  static_assert(Size <= 0xFFFF, "sinks take a 16-bit byte count");
+
+  uint32_t words[Size / 4];
+
+  APA102Frame() {
+    memset(words, 0, sizeof(words));
+    if (Chipset != SK9822) {
+      for (unsigned w = (StartBytes / 4) + LEDCount; w < Size / 4; ++w) {
+        words[w] = 0xFF;
+      }
+    }
+  }
+
+  const uint8_t *bytes() const {
+    return (const uint8_t *)words;
+  }
+
+  // Splits FastLED's brightness between the 5-bit global brightness and the color channels the same way FastLED's
+  // APA102 controller does with FASTLED_USE_GLOBAL_BRIGHTNESS, so dim settings keep more of their color resolution.
+  // channel(i, c) gives channel c, r, g or b, of LED i in 8.8 fixed point, already through its output curve.
+  // Whatever the channel scale leaves below 8 bits is temporally dithered with ditherChannel, each channel's fraction
+  // carrying over in residuals to the next frame.
+  template<class Channel>
+  void encode(Channel channel, uint8_t brightness, uint8_t *residuals) {
+    const uint8_t global = ((((uint16_t)brightness + 1) * 0x1F - 1) >> 8) + 1;
+    const uint16_t scale = (0x1F * brightness + (global >> 1)) / global + 1;
+    uint8_t *out = (uint8_t *)words + StartBytes;
+    for (unsigned i = 0; i < LEDCount; ++i, out += 4, residuals += 3) {
+      out[0] = 0xE0 | global;
+      for (uint8_t c = 0; c < 3; ++c) {
+        // blue, green, red
+        const uint16_t value = channel(i, 2 - c);
+        out[1 + c] = ditherChannel(((uint32_t)value * scale) >> 8, residuals[2 - c]);
+      }
+    }
+  }
+
+  // estimated current draw while this frame is showing
+  uint32_t microamps(const LEDCurrentModel &model) const {
+    uint32_t lit[3] = {0}; // channel steps times global brightness, r, g, b
+    const uint8_t *led = bytes() + StartBytes;
+    for (unsigned i = 0; i < LEDCount; ++i, led += 4) {
+      const uint8_t global = led[0] & 0x1F;
+      for (uint8_t c = 0; c < 3; ++c) {
+        lit[2 - c] += led[1 + c] * global;
+      }
+    }
+    uint32_t total = model.idleMicroamps * LEDCount;
+    for (uint8_t c = 0; c < 3; ++c) {
+      total += (uint64_t)lit[c] * model.channelMicroamps[c] / (0xFF * 0x1F);
+    }
+    return total;
+  }
+};
+
+#ifdef ARDUINO_ARCH_SAMD
+// Writes frames out an SPI port a byte at a time, returning once the whole frame is out. The port must already be
+// running as a master with its transaction begun.
+class SPIBlockingSink {
+  SPIClass &spi;
+
+public:
+  SPIBlockingSink(SPIClass &spi) : spi(spi) { }
+
+  void begin() { }
+
+  void transmit(const uint8_t *bytes, uint16_t count) {
+    for (uint16_t i = 0; i < count; ++i) {
+      spi.transfer(bytes[i]);
+    }
+  }
+};
+
+#endif
+
+// Host stand-in for SPIBlockingSink that records the byte stream
+class RecordingSPISink {
+public:
+  std::vector<uint8_t> stream;
+
+  void begin() { }
+
+  void transmit(const uint8_t *bytes, uint16_t count) {
+    stream.insert(stream.end(), bytes, bytes + count);
+  }
+};
+
+// LED output through a frame encoder. show() encodes the pixels into an APA102/SK9822 frame and writes it to the sink,
+// returning once it's out.
+// Every channel goes through Curves on the way out, then brightness, which is still FastLED's global brightness,
+// applied in 16 bits and dithered so dim settings keep smooth fades.
+// With a current budget set, each frame's draw at full brightness is estimated from Model first, and brightness is
+// capped to what keeps that frame within the budget. Frames that are mostly dark don't get dimmed at all. The cap
+// drops right away so a bright frame never goes out over budget, and comes back up over about a second.
+template <ESPIChipsets Chipset, unsigned LEDCount, const OutputCurves &Curves, const LEDCurrentModel &Model, class Sink>
+class LEDOutput {
+public:
+  typedef APA102Frame<Chipset, LEDCount> Frame;
+
+private:
+  static const uint8_t HeadroomRise = 64; // per ms, in 8.8 brightness
+  // linear curves would make the lookup a per-channel no-op, so it's left out. none of the pixels shown are past 0xFF00.
+  static constexpr bool LinearCurves = Curves.isIdentity();
+
+  Frame frame;
+  const CRGB *leds = NULL;
+  uint8_t residuals[3 * LEDCount] = {0}; // dithering carry for each channel
+  uint16_t budgetMilliamps = 0;
+  uint16_t headroom = 0xFFFF; // brightness cap from the budget, 8.8
+  unsigned long lastHeadroomMillis = 0;
+  uint8_t shownBrightness = 0;
+
+  // the highest brightness, 8.8, that keeps a frame of these channels within the budget. dithering can send any lit
+  // channel out a step over its exact value, so the budget keeps a step per lit channel in reserve.
+  template<class Channel>
+  uint16_t budgetBrightness(Channel channel) {
+    uint32_t load[3] = {0}; // r, g, b, in 8.8 channel steps
+    uint16_t litChannels[3] = {0};
+    for (unsigned i = 0; i < LEDCount; ++i) {
+      for (uint8_t c = 0; c < 3; ++c) {
+        const uint16_t value = channel(i, c);
+        load[c] += value;
+        litChannels[c] += (value != 0);
+      }
+    }
+    uint32_t reserve = Model.idleMicroamps * LEDCount;
+    uint32_t lit = 0; // microamps over idle at full brightness
+    for (uint8_t c = 0; c < 3; ++c) {
+      reserve += litChannels[c] * Model.channelMicroamps[c] / 0xFF;
+      lit += (load[c] >> 8) * Model.channelMicroamps[c] / 0xFF;
+    }
+    const uint32_t budget = budgetMilliamps * 1000;
+    if (budget <= reserve) {
+      return 0;
+    }
+    if (lit <= budget - reserve) {
+      return 0xFFFF;
+    }
+    return (uint64_t)(budget - reserve) * 0xFF00 / lit;
+  }
+
+  template<class Channel>
+  void transmit(Channel raw) {
+    auto channel = [&raw](unsigned i, uint8_t c) -> uint16_t {
+      if constexpr (LinearCurves) {
+        return raw(i, c);
+      } else {
+        return Curves.apply(c, raw(i, c));
+      }
+    };
+    uint8_t brightness = FastLED.getBrightness();
+    if (budgetMilliamps) {
+      const unsigned long now = millis();
+      const uint32_t risen = headroom + MIN(now - lastHeadroomMillis, 0xFFFFul) * HeadroomRise;
+      lastHeadroomMillis = now;
+      headroom = MIN((uint32_t)budgetBrightness(channel), risen);
+      brightness = MIN(brightness, headroom >> 8);
+    }
+    shownBrightness = brightness;
+    frame.encode(channel, brightness, residuals);
+    sink.transmit(frame.bytes(), Frame::Size);
+  }
+
+public:
+  Sink sink;
+
+  template <typename... SinkArgs>
+  LEDOutput(SinkArgs... sinkArgs) : sink(sinkArgs...) { }
+
+  void begin(const CRGB *leds) {
+    this->leds = leds;
+    sink.begin();
+  }
+
+  // caps brightness per frame to keep the LEDs' estimated draw under milliamps, 0 for no limit
+  void setCurrentBudget(uint16_t milliamps) {
+    budgetMilliamps = milliamps;
+    headroom = 0xFFFF;
+  }
+
+  // the brightness the last frame went out at, after the budget
+  uint8_t brightness() {
+    return shownBrightness;
+  }
+
+  // estimated draw of the last frame shown
+  uint16_t milliamps() {
+    return frame.microamps(Model) / 1000;
+  }
+
+  void show() {
+    if (!leds) {
+      return;
+    }
+    const CRGB *pixels = leds;
+    transmit([pixels](unsigned i, uint8_t c) { return (uint16_t)(pixels[i][c] << 8); });
+  }
+};
+
+#if EVM_HARDWARE_VERSION > 2
+const ESPIChipsets kLEDChipset = SK9822;
+#else
+const ESPIChipsets kLEDChipset = APA102;
+#endif
+
+// The palettes were converted for LEDs with per-channel gammas already (see palettes.h) and patterns mix them linearly,
+// so the board's curves start out linear. Tune them here and every pattern picks them up.
+inline constexpr OutputCurves kEVMOutputCurves = MakeOutputCurves({1, 0xFF}, {1, 0xFF}, {1, 0xFF});
+
+// SK9822-EC20s at 5V, about 12.5mA per channel so a full white frame comes to the 15W the board can pull
+inline constexpr LEDCurrentModel kEVMCurrentModel = {1000, {12500, 12500, 12500}};
+
+#if defined(ARDUINO_ARCH_SAMD)
+typedef LEDOutput<kLEDChipset, NUM_LEDS, kEVMOutputCurves, kEVMCurrentModel, SPIBlockingSink> EVMLEDOutput;
+#else
+typedef LEDOutput<kLEDChipset, NUM_LEDS, kEVMOutputCurves, kEVMCurrentModel, RecordingSPISink> EVMLEDOutput;
+#endif
+
+// defined in main.cpp
+extern EVMLEDOutput ledOutput;
+
+void DrawModal(int fps, unsigned long durationMillis, std::function<void(unsigned long elapsed)> tick) {
+  int delayMillis = 1000/fps;
+  unsigned long start = millis();
+  unsigned long elapsed = 0;
+  do {
+    tick(elapsed);
+    ledOutput.show();
+    delay(delayMillis);
+    elapsed = millis() - start;
+  } while (elapsed < durationMillis);
+}
+
+#endif
@@ -30,7 +30,6 @@ static const uint8_t brightnessDialPin = 9;
 /* --------------------------------- */
 
 #define FASTLED_USE_PROGMEM 1
-#define FASTLED_USE_GLOBAL_BRIGHTNESS 1
 #include <FastLED.h>
 
 // starts device in random modes, plus cycles in auto spoke variations
@@ -41,12 +40,14 @@ bool fullRandom = false;
 #include "PatternManager.h"
 #include "power.h"
 #include "ledgraph.h"
+#include "ledoutput.h"
 
 #include <functional>
 
 #define WAIT_FOR_SERIAL 0
 
 EVMDrawingContext ctx;
+EVMLEDOutput ledOutput(ledsSPI);
 
 FrameCounter fc;
 PatternManager<EVMDrawingContext> patternManager(ctx);
@@ -88,7 +89,7 @@ void startupWelcome() {
     }
   });
   ctx.leds.fill_solid(CRGB::Black);
-  FastLED.show();
+  ledOutput.show();
 }
 
 void setup() {
@@ -112,25 +113,29 @@ void setup() {
   
   powerManager.setup_adc(brightnessDialPort, brightnessDialPin);
 
+  ledsSPI.begin();
   // use the alternate sercoms each of these SPI ports (SERCOM3)
   pinPeripheral(LEDS_MISO, PIO_SERCOM_ALT);
   pinPeripheral(LEDS_SCK,  PIO_SERCOM_ALT);
   pinPeripheral(LEDS_MOSI, PIO_SERCOM_ALT);
+  // the LEDs are the only thing on this bus, so the transaction never ends
+  ledsSPI.beginTransaction(SPISettings(12000000, MSBFIRST, SPI_MODE0));
 
-  // Make sure we're not running the SPI while in standby
+  // Make sure we're not running the SPI while in standby. CTRLA is enable-protected, so disable the SERCOM around the write.
+  SERCOM3->SPI.CTRLA.bit.ENABLE = 0;
+  while (SERCOM3->SPI.SYNCBUSY.bit.ENABLE);
   SERCOM3->SPI.CTRLA.bit.RUNSTDBY = 0;
+  SERCOM3->SPI.CTRLA.bit.ENABLE = 1;
+  while (SERCOM3->SPI.SYNCBUSY.bit.ENABLE);
 
-  const ESPIChipsets chipset = (EVM_HARDWARE_VERSION > 2 ? SK9822 : APA102);
-  FastLED.addLeds<chipset, LEDS_MOSI, LEDS_SCK, BGR>(ctx.leds, ctx.leds.size());
+  ledOutput.begin(ctx.leds);
+  ledOutput.setCurrentBudget(LED_CURRENT_BUDGET_MA);
   FastLED.setBrightness(0);
 
   fc.tick();
 
   patternManager.setup();
 
-  initLEDGraph();
-  assert(ledgraph.adjList.size() == NUM_LEDS, "adjlist size should match num_leds");
-
   setupDoneTime = millis();
 }
 
@@ -140,7 +145,7 @@ void serialTimeoutIndicator() {
   if ((millis() - setupDoneTime) % 250 < 100) {
     ctx.leds.fill_solid(CRGB::Red);
   }
-  FastLED.show();
+  ledOutput.show();
   delay(20);
 }
 
@@ -166,7 +171,7 @@ void loop() {
 
   patternManager.loop();
   
-  FastLED.show();
+  ledOutput.show();
 
   fc.tick();
   fc.clampToFramerate(120);
@@ -73,59 +73,202 @@ public:
 
 /* ------------------------------------------------------------------------------------------------------ */
 
-// a lil patternlet that can be instantiated to run bits
-class BitsFiller {
-public:
+// how bits choose their next pixel and when new ones spawn, shared by fillers on every layout
+struct BitsRules {
   typedef enum : uint8_t { random, priority, split } FlowRule;
   typedef enum : uint8_t { maintainPopulation, manualSpawn } SpawnRule;
- 
+};
+
+// The parts of a bits filler that don't depend on its policies: bit storage, the clock, and the flow and draw steps.
+// Flow rules come from an emitter, any object with the configuration fields of a BasicBitsFiller. Each bit is tagged
+// with the index of the emitter that made it so several emitters can share one pool.
+// Layout is the board the bits run on, see BoardLayout.
+template <class Layout>
+class BasicBitsFillerBase : public BitsRules {
+public:
+  typedef typename Layout::PixelIndex PixelIndex;
+  typedef typename Layout::PixelMask PixelMask;
+  typedef typename Layout::NextHops NextHops;
+  typedef LayoutDrawingContext<Layout> DrawingContext;
+  typedef LayoutAccumulationContext<Layout> AccumulationContext;
+  static constexpr PixelIndex NoPixel = Layout::NoPixel;
+
+  class BitPool;
+
+  // A bit's fields live in BitPool's per-field arrays. Bit is a view of one slot, so copies of it refer to the same bit.
   struct Bit {
-    friend BitsFiller;
+    friend BasicBitsFillerBase;
   private:
-    unsigned long birthmilli;
-    bool firstFrame = true;
+    unsigned long &birthmilli;
+    bool &firstFrame;
+    const unsigned long &now;
   public:
-    uint8_t colorIndex; // storage only
+    uint8_t &colorIndex; // storage only
     
-    uint8_t px;
-    EdgeTypesPair directions;
+    PixelIndex &px;
+    EdgeTypesPair &directions;
     
-    unsigned long lifespan;
+    unsigned long &lifespan;
+
+    CRGB &color;
+    uint8_t &brightness;
 
-    CRGB color;
-    uint8_t brightness = 0xFF;
+    Bit(BitPool &pool, uint8_t slot)
+      : birthmilli(pool.birthmilli[slot]), firstFrame(pool.firstFrame[slot]), now(pool.now), colorIndex(pool.colorIndex[slot]), px(pool.px[slot]),
+        directions(pool.directions[slot]), lifespan(pool.lifespan[slot]), color(pool.color[slot]), brightness(pool.brightness[slot]) { }
 
-    Bit(int px, EdgeTypesPair directions, unsigned long lifespan) 
-      : px(px), directions(directions), lifespan(lifespan) {
-      reset();
+    // by the filler's clock, not millis()
+    unsigned long age() {
+      return now - birthmilli;
     }
+  };
 
-    void reset() {
-      birthmilli = millis();
-      color = CHSV(random8(), 0xFF, 0xFF);
+  // Fixed-capacity structure-of-arrays bit storage, allocated once. Removal swaps the last bit into the hole.
+  // One slot past capacity is scratch space handed out when the pool is full, so callers can still configure a bit that's never flowed or drawn.
+  class BitPool {
+    friend BasicBitsFillerBase;
+    uint8_t count = 0;
+    uint8_t cap;
+    uint8_t *storage;
+  public:
+    unsigned long now = 0; // the owning filler's clock, as of its last step
+
+    // widest fields first so they stay aligned within the single allocation
+    unsigned long *birthmilli;
+    unsigned long *lifespan;
+    PixelIndex *px;
+    PixelIndex *nextPx; // committed next hop, NoPixel if the bit dies when it reaches the end of px
+    PixelIndex *hopFrom; // px that nextPx was planned from, so moves made by pattern code get replanned
+    CRGB *color;
+    EdgeTypesPair *directions;
+    uint8_t *brightness;
+    uint8_t *colorIndex;
+    uint8_t *phase; // Q0.8 progress from px toward nextPx
+    uint8_t *emitter; // which emitter's rules the bit follows
+    bool *firstFrame;
+
+    BitPool(uint8_t capacity) : cap(capacity) {
+      const unsigned slots = capacity + 1;
+      storage = new uint8_t[slots * (2 * sizeof(unsigned long) + 3 * sizeof(PixelIndex) + sizeof(CRGB) + 5 + sizeof(bool))];
+      birthmilli = (unsigned long *)storage;
+      lifespan = birthmilli + slots;
+      px = (PixelIndex *)(lifespan + slots);
+      nextPx = px + slots;
+      hopFrom = nextPx + slots;
+      color = (CRGB *)(hopFrom + slots);
+      directions = (EdgeTypesPair *)(color + slots);
+      brightness = (uint8_t *)(directions + slots);
+      colorIndex = brightness + slots;
+      phase = colorIndex + slots;
+      emitter = phase + slots;
+      firstFrame = (bool *)(emitter + slots);
     }
+    ~BitPool() {
+      delete [] storage;
+    }
+    BitPool(const BitPool &) = delete;
+    BitPool &operator=(const BitPool &) = delete;
+
+    inline uint8_t size() const { return count; }
+    inline uint8_t capacity() const { return cap; }
+    inline bool full() const { return count == cap; }
+
+    inline Bit operator[](uint8_t slot) { return Bit(*this, slot); }
+
+    class iterator {
+      BitPool &pool;
+      uint8_t slot;
+    public:
+      iterator(BitPool &pool, uint8_t slot) : pool(pool), slot(slot) { }
+      inline Bit operator*() const { return pool[slot]; }
+      inline iterator &operator++() { ++slot; return *this; }
+      inline bool operator!=(const iterator &other) const { return slot != other.slot; }
+    };
+    iterator begin() { return iterator(*this, 0); }
+    iterator end() { return iterator(*this, count); }
 
-    unsigned long age() {
-      return millis() - birthmilli;
+    void clear() {
+      count = 0;
+    }
+
+  private:
+    // returns the scratch slot if full
+    uint8_t allocate() {
+      return full() ? cap : count++;
+    }
+
+    void copy(uint8_t from, uint8_t to) {
+      birthmilli[to] = birthmilli[from];
+      lifespan[to] = lifespan[from];
+      color[to] = color[from];
+      px[to] = px[from];
+      directions[to] = directions[from];
+      brightness[to] = brightness[from];
+      colorIndex[to] = colorIndex[from];
+      phase[to] = phase[from];
+      nextPx[to] = nextPx[from];
+      hopFrom[to] = hopFrom[from];
+      emitter[to] = emitter[from];
+      firstFrame[to] = firstFrame[from];
+    }
+
+    void swapRemove(uint8_t slot) {
+      if (slot != count - 1) {
+        copy(count - 1, slot);
+      }
+      --count;
     }
   };
 
-private:
+protected:
+  DrawingContext &ctx;
+  AccumulationContext *trails = NULL; // see accumulateTrails()
+  uint8_t *trailResiduals = NULL; // dithering carry for each channel of trails
 
-  EVMDrawingContext &ctx;
+  BasicBitsFillerBase(DrawingContext &ctx, uint8_t capacity) : ctx(ctx), bits(capacity) {
+    bits.now = millis();
+  }
+
+  ~BasicBitsFillerBase() {
+    delete trails;
+    delete[] trailResiduals;
+  }
+
+  void fadeTrails(unsigned long elapsed) {
+    if (trails) {
+      trails->decay(fade.factor(elapsed));
+    } else {
+      ctx.decay(fade.factor(elapsed));
+    }
+  }
+
+  // brings ctx up to date with the trails once the step has drawn its bits
+  void resolveTrails() {
+    if (trails) {
+      resolveContext(*trails, ctx, trailResiduals);
+    }
+  }
+
+  // Per-emitter motion and spawn bookkeeping
+  struct EmitterState {
+    unsigned long phaseRemainder = 0; // sub-phase motion carried between frames, in 1/1000ths of a phase unit
+    unsigned long lastBitSpawn = 0;
+  };
 
-  unsigned long lastTick = 0;
-  unsigned long lastMove = 0;
-  unsigned long lastBitSpawn = 0;
+  static inline PixelIndex randomBelow(PixelIndex n) {
+    return (sizeof(PixelIndex) == 1 ? random8() : random16()) % n;
+  }
 
-  uint8_t spawnLocation() {
-    if (spawnPixels) {
-      return spawnPixels->at(random8()%spawnPixels->size());
+  template <class Emitter>
+  PixelIndex spawnLocation(const Emitter &e) {
+    if (e.spawnPixels) {
+      return e.spawnPixels->nth(randomBelow(e.spawnPixels->size()));
     }
-    return random16()%NUM_LEDS;
+    return random16()%Layout::LEDCount;
   }
 
-  Bit &makeBit(Bit *fromBit=NULL) {
+  template <class Emitter>
+  Bit makeBit(const Emitter &e, uint8_t emitterIndex) {
     // the bit directions at the BitsFiller level may contain multiple options, choose one at random for this bit
     EdgeTypesPair directionsForBit = {0};
 
@@ -133,7 +276,7 @@ private:
       uint8_t bit[EdgeTypesCount] = {0};
       uint8_t bitcount = 0;
       for (int i = 0; i < EdgeTypesCount; ++i) {
-        uint8_t nybble = bitDirections.pair >> (n * EdgeTypesCount);
+        uint8_t nybble = e.bitDirections.pair >> (n * EdgeTypesCount);
         if (nybble & 1 << i) {
           bit[bitcount++] = i;
         }
@@ -143,38 +286,83 @@ private:
       }
     }
 
-    if (fromBit) {
-      bits.emplace_back(*fromBit);
-    } else {
-      bits.emplace_back(spawnLocation(), directionsForBit, lifespan);
+    PixelIndex px = spawnLocation(e);
+    if (bits.full()) {
+      logdf("BitsFiller pool full at %u bits", bits.capacity());
+    }
+    uint8_t slot = bits.allocate();
+    bits.px[slot] = px;
+    bits.directions[slot] = directionsForBit;
+    bits.lifespan[slot] = e.lifespan;
+    bits.birthmilli[slot] = bits.now;
+    bits.color[slot] = CHSV(random8(), 0xFF, 0xFF);
+    bits.brightness[slot] = 0xFF;
+    bits.colorIndex[slot] = 0;
+    bits.phase[slot] = 0;
+    bits.hopFrom[slot] = NoPixel; // planned once pattern code has had a chance to place the bit
+    bits.emitter[slot] = emitterIndex;
+    bits.firstFrame[slot] = true;
+    return bits[slot];
+  }
+
+  // Spawns bits to bring population up to the emitter's maxSpawnBits, calling addBit() to make each one
+  template <class Emitter, class AddBit>
+  void spawnBits(const Emitter &e, EmitterState &state, uint8_t population, AddBit addBit) {
+    if (e.spawnRule != maintainPopulation) {
+      return;
     }
-    return bits.back();
+    for (unsigned b = population; b < e.maxSpawnBits; ++b) {
+      if (e.maxBitsPerSecond != 0 && bits.now - state.lastBitSpawn < 1000 / e.maxBitsPerSecond) {
+        continue;
+      }
+      addBit();
+      state.lastBitSpawn = bits.now;
+    }
+  }
+
+  // bits move in Q0.8 fractions of a pixel, carrying the remainder so motion doesn't drift from speed
+  template <class Emitter>
+  uint16_t phaseStep(const Emitter &e, EmitterState &state, unsigned long elapsed) {
+    state.phaseRemainder += MIN(elapsed, 1000ul) * e.speed * 0x100;
+    uint16_t step = state.phaseRemainder / 1000;
+    state.phaseRemainder %= 1000;
+    return step;
   }
 
   void killBit(uint8_t bitIndex) {
-    bits.erase(bits.begin() + bitIndex);
+    // swaps the last bit into bitIndex. update() walks bits back to front so the moved bit has already been flowed.
+    bits.swapRemove(bitIndex);
   }
 
-  void splitBit(Bit &bit, uint8_t toIndex) {
-    Bit &split = makeBit(&bit);
-    split.px = toIndex;
+  void splitBit(uint8_t bitIndex, PixelIndex toIndex) {
+    if (bits.full()) {
+      // drop the split rather than grow
+      return;
+    }
+    // the copy sets off from the same pixel at the same phase, just along a different edge
+    uint8_t slot = bits.allocate();
+    bits.copy(bitIndex, slot);
+    bits.nextPx[slot] = toIndex;
   }
 
-  bool isIndexAllowed(uint8_t index) {
-    if (allowedPixels) {
-      return allowedPixels->end() != allowedPixels->find(index);
+  template <class Emitter>
+  bool isIndexAllowed(const Emitter &e, PixelIndex index) {
+    if (e.allowedPixels) {
+      return e.allowedPixels->contains(index);
     }
     return true;
   }
 
-  vector<uint8_t> nextIndexes(uint8_t index, EdgeTypesPair bitDirections) {
-    vector<uint8_t> next;
-    switch (flowRule) {
+  template <class Emitter>
+  void nextIndexes(const Emitter &e, PixelIndex index, EdgeTypesPair bitDirections, NextHops &next) {
+    NextHops adj;
+    Layout::graph.nextHops(index, bitDirections, adj);
+    next.count = 0;
+    switch (e.flowRule) {
       case priority: {
-        auto adj = ledgraph.adjacencies(index, bitDirections);
-        for (auto edge : adj) {
-          if (isIndexAllowed(edge.to)) {
-            next.push_back(edge.to);
+        for (uint8_t i = 0; i < adj.count; ++i) {
+          if (isIndexAllowed(e, adj.px[i])) {
+            next.add(adj.px[i], adj.types[i]);
             break;
           }
         }
@@ -182,59 +370,183 @@ private:
       }
       case random:
       case split: {
-        vector<Edge> nextEdges;
-        auto adj = ledgraph.adjacencies(index, bitDirections);
-        for (auto a : adj) {
-          if (isIndexAllowed(a.to)) {
-            nextEdges.push_back(a);
+        NextHops nextEdges;
+        for (uint8_t i = 0; i < adj.count; ++i) {
+          // the same vertex can be reachable along more than one edge, only go there once
+          if (isIndexAllowed(e, adj.px[i]) && !nextEdges.contains(adj.px[i])) {
+            nextEdges.add(adj.px[i], adj.types[i]);
           }
         }
-        if (flowRule == split) {
-          if (nextEdges.size() == 1) {
+        if (e.flowRule == split) {
+          if (nextEdges.count == 1) {
             // flow normally if we're not actually splitting
-            next.push_back(nextEdges.front().to);
+            next = nextEdges;
           } else {
             // split along all allowed split directions, or none if none are allowed
-            for (Edge nextEdge : nextEdges) {
-              if (splitDirections & nextEdge.type) {
-                next.push_back(nextEdge.to);
+            for (uint8_t i = 0; i < nextEdges.count; ++i) {
+              if (e.splitDirections & nextEdges.types[i]) {
+                next.add(nextEdges.px[i], nextEdges.types[i]);
               }
             }
           }
-        } else if (nextEdges.size() > 0) {
-          // FIXME: EdgeType::random behavior doesn't work right with the way fadeUp is implemented
-          next.push_back(nextEdges.at(random8()%nextEdges.size()).to);
+        } else if (nextEdges.count > 0) {
+          uint8_t choice = random8()%nextEdges.count;
+          next.add(nextEdges.px[choice], nextEdges.types[choice]);
         }
         break;
       }
     }
-    // TODO: does not handle duplicates in the case of the same vertex being reachable via multiple edges
-    assert(next.size() <= 4, "no pixel in this design has more than 4 adjacencies but index %i had %u", index, next.size());
-    return next;
   }
 
-  bool flowBit(uint8_t bitIndex) {
-    vector<uint8_t> next = nextIndexes(bits[bitIndex].px, bits[bitIndex].directions);
-    if (next.size() == 0) {
-      // leaf behavior
+  // Commits to the edge the bit will travel out of its current pixel, splitting off copies for any other edges.
+  template <class Emitter>
+  void planHop(const Emitter &e, uint8_t bitIndex) {
+    NextHops next;
+    nextIndexes(e, bits.px[bitIndex], bits.directions[bitIndex], next);
+    bits.hopFrom[bitIndex] = bits.px[bitIndex];
+    if (next.count == 0) {
+      // leaf behavior, the bit fades out over its last hop and dies
+      bits.nextPx[bitIndex] = NoPixel;
+    } else {
+      bits.nextPx[bitIndex] = next.px[0];
+      for (uint8_t i = 1; i < next.count; ++i) {
+        splitBit(bitIndex, next.px[i]);
+      }
+    }
+  }
+
+  // Advances the bit by phaseStep, moving it through as many whole pixels as that covers. Kills bits that run off a leaf
+  // or outlive their lifespan, returning whether the bit is still alive.
+  template <class Emitter>
+  bool flowBit(const Emitter &e, uint8_t bitIndex, uint16_t phaseStep) {
+    if (bits.hopFrom[bitIndex] != bits.px[bitIndex]) {
+      planHop(e, bitIndex);
+    }
+    uint16_t phase = bits.phase[bitIndex] + phaseStep;
+    while (phase > 0xFF) {
+      if (bits.nextPx[bitIndex] == NoPixel) {
+        killBit(bitIndex);
+        return false;
+      }
+      bits.px[bitIndex] = bits.nextPx[bitIndex];
+      phase -= 0x100;
+      bits.phase[bitIndex] = 0;
+      uint8_t firstCopy = bits.size();
+      planHop(e, bitIndex);
+      // copies split off at the new pixel still have the rest of this step to travel, so they keep pace with this bit.
+      // they're past the end of the pool update() is walking, flow them here. back to front, as killBit expects.
+      for (uint8_t c = bits.size(); c-- > firstCopy;) {
+        flowBit(e, c, phase);
+      }
+    }
+    bits.phase[bitIndex] = phase;
+    if (bits.lifespan[bitIndex] != 0 && bits.now - bits.birthmilli[bitIndex] > bits.lifespan[bitIndex]) {
       killBit(bitIndex);
       return false;
+    }
+    return true;
+  }
+
+  // Bits on the same edge headed the same way follow the same path from here on, so fold them into the lowest slot, however
+  // far apart their arrivals were. That bounds the population to a bit per edge, direction and emitter. The survivor
+  // moves up to the leading bit's phase, keeps its own age and lifespan, and takes the brighter of each color channel.
+  void mergeHeadings() {
+    const uint8_t NoOwner = 0xFF; // past the scratch slot
+    uint8_t owner[Layout::LEDCount]; // first surviving bit at each pixel
+    uint8_t nextAtPx[0xFF]; // the rest of them, chained through their slots
+    memset(owner, NoOwner, sizeof(owner));
+    for (uint8_t b = 0; b < bits.size();) {
+      PixelIndex px = bits.px[b];
+      if (bits.firstFrame[b] || bits.hopFrom[b] != px) {
+        // not planned yet, its heading isn't known
+        ++b;
+        continue;
+      }
+      uint8_t *link = &owner[px];
+      while (*link != NoOwner) {
+        uint8_t o = *link;
+        if (bits.nextPx[o] == bits.nextPx[b] && bits.directions[o].pair == bits.directions[b].pair && bits.emitter[o] == bits.emitter[b]) {
+          break;
+        }
+        link = &nextAtPx[o];
+      }
+      if (*link == NoOwner) {
+        *link = b;
+        nextAtPx[b] = NoOwner;
+        ++b;
+        continue;
+      }
+      uint8_t o = *link;
+      bits.color[o] |= bits.color[b];
+      bits.brightness[o] = MAX(bits.brightness[o], bits.brightness[b]);
+      bits.phase[o] = MAX(bits.phase[o], bits.phase[b]);
+      // the last bit is swapped into b and hasn't been looked at yet
+      killBit(b);
+    }
+  }
+
+  template <class Context>
+  void drawBit(uint8_t b, Context &into) {
+    typedef typename std::remove_reference<decltype(into.leds[0])>::type Pixel;
+    Pixel color = bits.color[b];
+    color.nscale8(bits.brightness[b]);
+
+    // split the bit between the pixel it's leaving and the one it's heading to
+    uint8_t phase = bits.phase[b];
+    PixelIndex px = bits.px[b];
+    into.markDirty();
+    into.leds[px] = blend(into.leds[px], color, 0xFF - phase);
+    PixelIndex nextPx = bits.nextPx[b];
+    if (phase > 0 && nextPx != NoPixel) {
+      into.leds[nextPx] = blend(into.leds[nextPx], color, phase);
+    }
+    bits.firstFrame[b] = false;
+  }
+
+  void drawBit(uint8_t b) {
+    if (trails) {
+      drawBit(b, *trails);
     } else {
-      bits[bitIndex].px = next.front();
-      for (unsigned i = 1; i < next.size(); ++i) {
-        splitBit(bits[bitIndex], next[i]);
+      drawBit(b, ctx);
+    }
+  }
+
+  // Runs step(mils, elapsed) to bring the clock up to now, in fixed steps if fixedStepMillis is set
+  template <class Step>
+  void advanceClock(unsigned long now, Step step) {
+    if (fixedStepMillis == 0) {
+      step(now, now - bits.now);
+      return;
+    }
+    uint8_t steps = 0;
+    while (now - bits.now >= fixedStepMillis) {
+      if (steps++ == maxCatchUpSteps) {
+        bits.now = now - (now - bits.now) % fixedStepMillis;
+        break;
       }
+      step(bits.now + fixedStepMillis, fixedStepMillis);
     }
-    return true;
   }
 
 public:
+  static const uint8_t kDefaultBitCapacity = 64;
+
+  BitPool bits;
+
+  DecayTable fade = DecayTable(32); // half-life of the trails bits leave, 0 for no fading
+  bool mergeCollisions = true; // merge bits on the same edge headed the same way
+
+  // If nonzero, the filler simulates in steps of exactly this many milliseconds, running several steps per update to catch up
+  // when frames are late. Given the same seed and inputs it then draws the same frames however the loop happens to be timed.
+  uint8_t fixedStepMillis = 0;
+  uint8_t maxCatchUpSteps = 8; // past this many steps behind, the backlog is dropped rather than stalling the frame
+
   void dumpBits() {
     logf("--------");
     logf("There are %i bits", bits.size());
     for (unsigned b = 0; b < bits.size(); ++b) {
-      Bit &bit = bits[b];
-      logf("Bit %i: px=%i, birthmilli=%lu, colorIndex=%u", b, bit.px, bit.birthmilli, bit.colorIndex);
+      Bit bit = bits[b];
+      logf("Bit %i: px=%i, next=%i, phase=%u, emitter=%u, birthmilli=%lu, colorIndex=%u", b, bit.px, bits.nextPx[b], bits.phase[b], bits.emitter[b], bit.birthmilli, bit.colorIndex);
       Serial.print("  Directions: 0b");
       for (int i = 2*EdgeTypesCount - 1; i >= 0; --i) {
         Serial.print(bit.directions.pair & (1 << i));
@@ -244,7 +556,138 @@ public:
     logf("--------");
   }
 
-  vector<Bit> bits;
+  void removeAllBits() {
+    bits.clear();
+  }
+
+  // Keeps the trails in an 8.8 layer of the filler's own and dithers them into ctx after each step. Slow fades then ease
+  // out along their half-life between 8-bit levels instead of stepping down them, for a layer and a byte per channel of
+  // memory and a pass over them per step. Anything else drawn into ctx has to go on after update().
+  void accumulateTrails() {
+    if (trails) {
+      return;
+    }
+    trails = new AccumulationContext();
+    trailResiduals = new uint8_t[3 * Layout::LEDCount]();
+    if (!ctx.isBlack()) {
+      trails->markDirty();
+      for (unsigned i = 0; i < Layout::LEDCount; ++i) {
+        trails->leds[i] = QCRGB(ctx.leds[i]);
+      }
+    }
+  }
+
+  void resetBitColors(EVMColorManager *colorManager) {
+    for (uint8_t b = 0; b < bits.size(); ++b) {
+      bits.color[b] = colorManager->getPaletteColor(bits.colorIndex[b], bits.color[b].getAverageLight());
+    }
+  }
+};
+
+typedef BasicBitsFillerBase<EVMLayout> BitsFillerBase;
+
+// Flow and spawn policies. Fixed policies make the rule a compile-time constant so its dispatch folds away,
+// runtime policies keep it settable for patterns that change rules on the fly.
+template <BitsRules::FlowRule Rule>
+struct FixedFlow {
+  static constexpr BitsRules::FlowRule flowRule = Rule;
+};
+
+struct RuntimeFlow {
+  BitsRules::FlowRule flowRule = BitsRules::random;
+};
+
+template <BitsRules::SpawnRule Rule>
+struct FixedSpawn {
+  static constexpr BitsRules::SpawnRule spawnRule = Rule;
+};
+
+struct RuntimeSpawn {
+  BitsRules::SpawnRule spawnRule = BitsRules::maintainPopulation;
+};
+
+struct NoBitHandler {
+  template <class Bit>
+  inline void operator()(Bit &bit) const { }
+};
+
+// std::function that does nothing until it's assigned, for fillers whose handlers are swapped at runtime
+template <class Layout>
+struct BasicBitHandler : public function<void(typename BasicBitsFillerBase<Layout>::Bit &)> {
+  typedef function<void(typename BasicBitsFillerBase<Layout>::Bit &)> Function;
+  BasicBitHandler() : Function(NoBitHandler()) { }
+  template <class Fn>
+  BasicBitHandler(Fn fn) : Function(fn) { }
+};
+
+typedef BasicBitHandler<EVMLayout> BitHandler;
+
+// The members of BasicBitsFillerBase used by the fillers built on it, which can't see them unqualified through a dependent base
+#define USING_BITS_FILLER_BASE(Base) \
+  using typename Base::PixelMask; \
+  using typename Base::DrawingContext; \
+  using typename Base::Bit; \
+  using typename Base::EmitterState; \
+  using Base::kDefaultBitCapacity; \
+  using Base::bits; \
+  using Base::ctx; \
+  using Base::fade; \
+  using Base::mergeCollisions; \
+  using Base::spawnBits; \
+  using Base::phaseStep; \
+  using Base::flowBit; \
+  using Base::mergeHeadings; \
+  using Base::planHop; \
+  using Base::drawBit; \
+  using Base::makeBit; \
+  using Base::fadeTrails; \
+  using Base::resolveTrails; \
+  using Base::advanceClock;
+
+// a lil patternlet that can be instantiated to run bits. the filler is its own single emitter.
+// handlers are called as fn(Bit &) and must be default constructible
+template <class FlowPolicy, class SpawnPolicy, class NewBitFn = NoBitHandler, class UpdateBitFn = NoBitHandler, class Layout = EVMLayout>
+class BasicBitsFiller : public BasicBitsFillerBase<Layout>, public FlowPolicy, public SpawnPolicy {
+public:
+  USING_BITS_FILLER_BASE(BasicBitsFillerBase<Layout>)
+private:
+  EmitterState state;
+
+  void step(unsigned long mils, unsigned long elapsed) {
+    bits.now = mils;
+
+    fadeTrails(elapsed);
+    
+    spawnBits(*this, state, bits.size(), [this]() { addBit(); });
+
+    uint16_t step = phaseStep(*this, state, elapsed);
+    if (step > 0) {
+      for (int i = bits.size() - 1; i >= 0; --i) {
+        if (bits.firstFrame[i]) {
+          // don't flow bits on the first frame. this allows pattern code to make their own bits that are displayed before being flowed
+          continue;
+        }
+        flowBit(*this, i, step);
+      }
+      if (mergeCollisions) {
+        mergeHeadings();
+      }
+    }
+
+    // update and draw each bit in a single pass over the pool
+    for (uint8_t b = 0; b < bits.size(); ++b) {
+      Bit bit = bits[b];
+      handleUpdateBit(bit);
+      if (bits.hopFrom[b] != bits.px[b]) {
+        // new or moved by pattern code
+        planHop(*this, b);
+      }
+      drawBit(b);
+    }
+    resolveTrails();
+  };
+
+public:
   uint8_t maxSpawnBits;
   uint8_t maxBitsPerSecond = 0; // limit how fast new bits are spawned, 0 = no limit
   uint8_t speed; // in pixels/second
@@ -252,120 +695,138 @@ public:
 
   unsigned long lifespan = 0; // in milliseconds, forever if 0
 
-  FlowRule flowRule = random;
-  SpawnRule spawnRule = maintainPopulation;
-  uint8_t fadeUpDistance = 0; // fade up n pixels ahead of bit motion
   EdgeTypes splitDirections = EdgeType::all; // if flowRule is split, which directions are allowed to split
   
-  const vector<uint8_t> *spawnPixels = NULL; // list of pixels to automatically spawn bits on
-  const set<uint8_t> *allowedPixels = NULL; // set of pixels that bits are allowed to travel to
+  const PixelMask *spawnPixels = NULL; // pixels to automatically spawn bits on
+  const PixelMask *allowedPixels = NULL; // pixels that bits are allowed to travel to
 
-  function<void(Bit &)> handleNewBit = [](Bit &bit){};
-  function<void(Bit &)> handleUpdateBit = [](Bit &bit){};
+  NewBitFn handleNewBit;
+  UpdateBitFn handleUpdateBit;
 
-  BitsFiller(EVMDrawingContext &ctx, uint8_t maxSpawnBits, uint8_t speed, unsigned long lifespan, vector<EdgeTypes> bitDirections)
-    : ctx(ctx), maxSpawnBits(maxSpawnBits), speed(speed), lifespan(lifespan) {
+  // capacity is the most bits that can be alive at once, including splits. 0 picks a default based on maxSpawnBits.
+  BasicBitsFiller(DrawingContext &ctx, uint8_t maxSpawnBits, uint8_t speed, unsigned long lifespan, vector<EdgeTypes> bitDirections, uint8_t capacity=0)
+    : BasicBitsFillerBase<Layout>(ctx, capacity ? capacity : MAX(maxSpawnBits, kDefaultBitCapacity)), maxSpawnBits(maxSpawnBits), speed(speed), lifespan(lifespan) {
       this->bitDirections = MakeEdgeTypesPair(bitDirections);
-    bits.reserve(maxSpawnBits);
   };
 
-  void fadeUpForBit(Bit &bit, uint8_t px, int distanceRemaining, unsigned long lastMove) {
-    vector<uint8_t> next = nextIndexes(px, bit.directions);
+  void update() {
+    update(millis());
+  }
 
-    unsigned long mils = millis();
-    unsigned long fadeUpDuration = 1000 * fadeUpDistance / speed;
-    for (uint8_t n : next) {
-      unsigned long fadeTimeSoFar = mils - lastMove + distanceRemaining * 1000/speed;
-      uint8_t progress = 0xFF * fadeTimeSoFar / fadeUpDuration;
-
-      CRGB existing = ctx.leds[n];
-      CRGB blended = blend(existing, bit.color, dim8_raw(progress));
-      blended.nscale8(bit.brightness);
-      ctx.leds[n] = blended;
-      
-      if (distanceRemaining > 0) {
-        fadeUpForBit(bit, n, distanceRemaining-1, lastMove);
-      }
-    }
+  // steps the filler's clock forward to now
+  void update(unsigned long now) {
+    advanceClock(now, [this](unsigned long mils, unsigned long elapsed) { step(mils, elapsed); });
   }
 
-  int fadeDown = 4; // fadeToBlackBy units per millisecond
-  void update() {
-    unsigned long mils = millis();
+  Bit addBit() {
+    Bit newbit = makeBit(*this, 0);
+    handleNewBit(newbit);
+    return newbit;
+  }
+};
 
-    ctx.leds.fadeToBlackBy(fadeDown * (mils - lastTick));
-    
-    if (spawnRule == maintainPopulation) {
-      for (unsigned b = bits.size(); b < maxSpawnBits; ++b) {
-        if (maxBitsPerSecond != 0 && mils - lastBitSpawn < 1000 / maxBitsPerSecond) {
-          continue;
-        }
-        addBit();
-        lastBitSpawn = mils;
-      }
+// runtime-configurable filler
+typedef BasicBitsFiller<RuntimeFlow, RuntimeSpawn, BitHandler, BitHandler> BitsFiller;
+
+// One emitter of a BitsEngine, with the same configuration fields as a BitsFiller
+template <class Layout>
+struct BasicBitsEmitter : public RuntimeFlow, public RuntimeSpawn {
+  typedef typename Layout::PixelMask PixelMask;
+  typedef BasicBitHandler<Layout> BitHandler;
+
+  uint8_t maxSpawnBits = 0;
+  uint8_t maxBitsPerSecond = 0; // limit how fast new bits are spawned, 0 = no limit
+  uint8_t speed = 0; // in pixels/second
+  EdgeTypesPair bitDirections = {0};
+
+  unsigned long lifespan = 0; // in milliseconds, forever if 0
+
+  EdgeTypes splitDirections = EdgeType::all; // if flowRule is split, which directions are allowed to split
+  
+  const PixelMask *spawnPixels = NULL; // pixels to automatically spawn bits on
+  const PixelMask *allowedPixels = NULL; // pixels that bits are allowed to travel to
+
+  BitHandler handleNewBit;
+  BitHandler handleUpdateBit;
+
+  BasicBitsEmitter() { }
+  BasicBitsEmitter(uint8_t maxSpawnBits, uint8_t speed, unsigned long lifespan, vector<EdgeTypes> bitDirections)
+    : maxSpawnBits(maxSpawnBits), speed(speed), bitDirections(MakeEdgeTypesPair(bitDirections)), lifespan(lifespan) { }
+};
+
+typedef BasicBitsEmitter<EVMLayout> BitsEmitter;
+
+// Several emitters sharing one pool of bits, flowed and drawn in a single pass. Each bit follows the rules of the emitter
+// that made it. This saves the RAM of a pool per emitter but no time: test_bits measures it no faster than a filler per
+// emitter fading once at the pattern, so Coupling, Intersex and SoundBits keep their fillers.
+template <uint8_t EmitterCount, class Layout = EVMLayout>
+class BitsEngine : public BasicBitsFillerBase<Layout> {
+public:
+  USING_BITS_FILLER_BASE(BasicBitsFillerBase<Layout>)
+  typedef BasicBitsEmitter<Layout> Emitter;
+private:
+  EmitterState states[EmitterCount];
+
+  void step(unsigned long mils, unsigned long elapsed) {
+    bits.now = mils;
+
+    fadeTrails(elapsed);
+
+    uint8_t population[EmitterCount] = {0};
+    for (uint8_t b = 0; b < bits.size(); ++b) {
+      ++population[bits.emitter[b]];
+    }
+    uint16_t steps[EmitterCount];
+    for (uint8_t e = 0; e < EmitterCount; ++e) {
+      spawnBits(emitters[e], states[e], population[e], [this, e]() { addBit(e); });
+      steps[e] = phaseStep(emitters[e], states[e], elapsed);
     }
 
-    if (mils - lastMove > 1000/speed) {
-      for (int i = bits.size() - 1; i >= 0; --i) {
-        if (bits[i].firstFrame) {
-          // don't flow bits on the first frame. this allows pattern code to make their own bits that are displayed before being flowed
-          continue;
-        }
-        bool bitAlive = flowBit(i);
-        if (bitAlive && bits[i].lifespan != 0 && bits[i].age() > bits[i].lifespan) {
-          killBit(i);
-        }
-      }
-      if (mils - lastMove > 2000/speed) {
-        lastMove = mils;
-      } else {
-        // This helps avoid time drift, which for some reason can make one device run consistently faster than another
-        lastMove += 1000/speed;
+    for (int i = bits.size() - 1; i >= 0; --i) {
+      uint8_t e = bits.emitter[i];
+      if (bits.firstFrame[i] || steps[e] == 0) {
+        // don't flow bits on the first frame. this allows pattern code to make their own bits that are displayed before being flowed
+        continue;
       }
+      flowBit(emitters[e], i, steps[e]);
     }
-    for (Bit &bit : bits) {
-      handleUpdateBit(bit);
+    if (mergeCollisions) {
+      mergeHeadings();
     }
 
-    for (Bit &bit : bits) {
-      CRGB color = bit.color;
-      color.nscale8(bit.brightness);
-      ctx.leds[bit.px] = color;
-    }
-    
-    if (fadeUpDistance > 0) {
-      for (Bit &bit : bits) {
-        if (bit.firstFrame) continue;
-        // don't show full fade-up distance right when bit is created
-        int bitFadeUpDistance = min((unsigned long)fadeUpDistance, speed * bit.age() / 1000);
-        if (bitFadeUpDistance > 0) {
-          // TODO: can fade-up take into account color advancement?
-          fadeUpForBit(bit, bit.px, bitFadeUpDistance - 1, lastMove);
-        }
+    // update and draw each bit in a single pass over the pool
+    for (uint8_t b = 0; b < bits.size(); ++b) {
+      Emitter &emitter = emitters[bits.emitter[b]];
+      Bit bit = bits[b];
+      emitter.handleUpdateBit(bit);
+      if (bits.hopFrom[b] != bits.px[b]) {
+        // new or moved by pattern code
+        planHop(emitter, b);
       }
+      drawBit(b);
     }
+    resolveTrails();
+  }
 
-    lastTick = mils;
+public:
+  Emitter emitters[EmitterCount];
 
-    for (Bit &bit : bits) {
-      bit.firstFrame = false;
-    }
-  };
+  // capacity is the most bits that can be alive at once across all emitters, including splits
+  BitsEngine(DrawingContext &ctx, uint8_t capacity=BasicBitsFillerBase<Layout>::kDefaultBitCapacity) : BasicBitsFillerBase<Layout>(ctx, capacity) { }
 
-  Bit &addBit() {
-    Bit &newbit = makeBit();
-    handleNewBit(newbit);
-    return newbit;
+  void update() {
+    update(millis());
   }
 
-  void removeAllBits() {
-    bits.clear();
+  // steps the engine's clock forward to now
+  void update(unsigned long now) {
+    advanceClock(now, [this](unsigned long mils, unsigned long elapsed) { step(mils, elapsed); });
   }
 
-  void resetBitColors(EVMColorManager *colorManager) {
-    for (Bit &bit : bits) {
-      bit.color = colorManager->getPaletteColor(bit.colorIndex, bit.color.getAverageLight());
-    }
+  Bit addBit(uint8_t emitter) {
+    Bit newbit = makeBit(emitters[emitter], emitter);
+    emitters[emitter].handleNewBit(newbit);
+    return newbit;
   }
 };
 
@@ -373,7 +834,8 @@ public:
 
 class DownstreamPattern : public Pattern {
 protected:
-  BitsFiller *bitsFiller;
+  typedef BasicBitsFiller<FixedFlow<BitsFillerBase::split>, FixedSpawn<BitsFillerBase::manualSpawn>> Filler;
+  Filler *bitsFiller;
   unsigned circleBits = 0;
   unsigned numAutoRotateColors = 3;
   unsigned numAutoRotatePaletteCycles = 1;
@@ -381,8 +843,7 @@ public:
   DownstreamPattern() {
     EdgeType circledirection = (random8()%2 ? EdgeType::clockwise : EdgeType::counterclockwise);
     vector<EdgeTypes> directions = {circledirection, EdgeType::outbound};
-    bitsFiller = new BitsFiller(ctx, 0, 24, 0, directions);
-    bitsFiller->flowRule = BitsFiller::split;
+    bitsFiller = new Filler(ctx, 0, 24, 0, directions, 128); // lots of splitting onto the spokes
   }
   ~DownstreamPattern() {
     delete bitsFiller;
@@ -411,13 +872,12 @@ public:
     if (circleBits != oldCircleBits) {
       bitsFiller->removeAllBits();
       for (unsigned i = 0; i < circleBits; ++i) {
-        BitsFiller::Bit &bit = bitsFiller->addBit();
+        Filler::Bit bit = bitsFiller->addBit();
         bit.px = circleleds[i * circleleds.size() / circleBits];
       }
     }
 
-    bitsFiller->fadeDown = circleBits+1;
-    bitsFiller->fadeUpDistance = max(2, 6-(int)circleBits);
+    bitsFiller->fade.setHalfLife(126 / (circleBits + 1)); // shorter trails as more bits circle
   }
 
   const char *description() {
@@ -435,8 +895,7 @@ public:
 
     DownstreamPattern::colorModeChanged();
 
-    bitsFiller->fadeDown = 0;
-    bitsFiller->fadeUpDistance = 1;
+    bitsFiller->fade.setHalfLife(0);
   }
   const char *description() {
     return "downstream-filled";
@@ -447,23 +906,25 @@ public:
 
 // FIXME: WIP
 class UpstreamPattern : public Pattern {
-  BitsFiller bitsFiller;
-  // typedef enum {trans, bi, rainbow, modeCount} ColorMode;
-  // ColorMode colorMode;
-public:
-  UpstreamPattern() : bitsFiller(ctx, 100, 40, 600, {EdgeType::inbound, EdgeType::clockwise | EdgeType::counterclockwise}) {
-    bitsFiller.flowRule = BitsFiller::priority;
-    bitsFiller.fadeUpDistance = 3;
-    bitsFiller.spawnPixels = &leafleds;
-    bitsFiller.handleNewBit = [](BitsFiller::Bit &bit) {
+  struct NewBit {
+    void operator()(BitsFillerBase::Bit &bit) const {
       // bit.color = CHSV(millis() / 4, 0xFF, 0xFF);
       CRGBPalette32 palette = Trans_Flag_gp;
       bit.color = ColorFromPalette(palette, random8());
-    };
-    bitsFiller.handleUpdateBit = [](BitsFiller::Bit &bit) {
+    }
+  };
+  struct UpdateBit {
+    void operator()(BitsFillerBase::Bit &bit) const {
       int raw = min(0xFF, max(0, (int)(0xFF - 0xFF * bit.age() / bit.lifespan)));
       bit.brightness = raw;
-    };
+    }
+  };
+  BasicBitsFiller<FixedFlow<BitsFillerBase::priority>, FixedSpawn<BitsFillerBase::maintainPopulation>, NewBit, UpdateBit> bitsFiller;
+  // typedef enum {trans, bi, rainbow, modeCount} ColorMode;
+  // ColorMode colorMode;
+public:
+  UpstreamPattern() : bitsFiller(ctx, 100, 40, 600, {EdgeType::inbound, EdgeType::clockwise | EdgeType::counterclockwise}) {
+    bitsFiller.spawnPixels = &leafLedsMask;
   }
 
   void update() {
@@ -514,16 +975,19 @@ class HeartBeatPattern : public Pattern, public FFTProcessing {
   unsigned long diastoleAt = 0;
   const CRGB bloodColor = CRGB(0xFF, 0, 0x15);
   
-  int fadeDown = 3;
+  const uint16_t fadeHalfLife = 57;
   float avgAmp = 0;
 
   bool usingPacemaker = false;
 
-  BitsFiller pumpFiller;
+protected:
+  // bits are only added on beats
+  BasicBitsFiller<FixedFlow<BitsFillerBase::split>, FixedSpawn<BitsFillerBase::manualSpawn>> pumpFiller;
 public:
   HeartBeatPattern() : pumpFiller(ctx, 0, 30, 1200, {EdgeType::outbound}) {
-    pumpFiller.flowRule = BitsFiller::split;
-    pumpFiller.fadeDown = fadeDown;
+    pumpFiller.fade.setHalfLife(fadeHalfLife);
+    // the beats are dim and fade slowly, at 8 bits their tails step down and the faint blue sticks on
+    pumpFiller.accumulateTrails();
     pumpFiller.splitDirections = EdgeType::outbound;
 #if USE_PACEMAKER
     pinMode(SDA, INPUT_PULLDOWN);
@@ -548,14 +1012,14 @@ public:
 
       // static int systole_spawnpixels[] = {earthleds[0], venusleds[0], marsleds[0]};
       // for (unsigned i = 0; i < ARRAY_SIZE(systole_spawnpixels); ++i) {
-      //   BitsFiller::Bit &bit = pumpFiller.addBit();
+      //   BitsFillerBase::Bit bit = pumpFiller.addBit();
       //   bit.px = systole_spawnpixels[i];
       //   bit.color = scaledColor;
       // }
     } else {
       // diastole
       for (unsigned i = 0; i < spoke_tip_leds.size(); ++i) {
-        BitsFiller::Bit &bit = pumpFiller.addBit();
+        BitsFillerBase::Bit bit = pumpFiller.addBit();
         bit.px = spoke_tip_leds[i];
         bit.directions.edgeTypes.first = EdgeType::inbound;
         bit.color = scaledColor;
@@ -563,7 +1027,7 @@ public:
       
       for (unsigned i = 0; i < 6; ++i) {
         const int circleSixth = circleleds.size() / 6;
-        BitsFiller::Bit &bit = pumpFiller.addBit();
+        BitsFillerBase::Bit bit = pumpFiller.addBit();
         bit.px = circleleds[(i>>1) * circleleds.size() / 3 + circleSixth + i%2];
         bit.directions.edgeTypes.first = EdgeType::outbound;
         bit.directions.edgeTypes.second = (i%2 == 0 ? EdgeType::counterclockwise : EdgeType::clockwise);
@@ -617,17 +1081,18 @@ bool earthMarsSuppressed = false;
 class CouplingPattern : public Pattern {
   enum { coupling, looking } state = looking;
   BitsFiller *spokesFillers[2];
-  set<uint8_t> allowedPixels[2];
+  PixelMask allowedPixels[2];
+  DecayTable fade = DecayTable(43); // both fillers' trails fade together
   unsigned long lastStateChange = 0;
 public:
   CouplingPattern() {
     for (int i = 0; i < 2; ++i) {
       spokesFillers[i] = new BitsFiller(ctx, 8, 50, 3000, {Edge::outbound, Edge::clockwise | Edge::counterclockwise});
-      spokesFillers[i]->spawnPixels = &circleleds;
+      spokesFillers[i]->spawnPixels = &circleLedsMask;
       spokesFillers[i]->allowedPixels = &allowedPixels[i];
       spokesFillers[i]->spawnRule = BitsFiller::maintainPopulation;
       spokesFillers[i]->maxBitsPerSecond = 10;
-      spokesFillers[i]->fadeDown = 0;
+      spokesFillers[i]->fade.setHalfLife(0);
       spokesFillers[i]->flowRule = BitsFiller::split;
       spokesFillers[i]->splitDirections = EdgeType::outbound;
     }
@@ -649,12 +1114,12 @@ public:
     static const unsigned lookingDuration = 150; // dang, standards++
 
     unsigned long mils = millis();
-    ctx.leds.fadeToBlackBy(3 * frameTime());
+    decayContexts(fade.factor(frameTime()), ctx);
 
     if (state == looking && mils - lastStateChange > lookingDuration) {
-      const vector<uint8_t> * const planetspokelists[] = {&venusleds, &marsleds};
-      const vector<uint8_t> * const earthspokelists[] = {&earthleds, &earthasvenusleds, &earthasmarsleds};
-      const vector<uint8_t> *spokes[2] = {0};
+      const PixelMask * const planetspokelists[] = {&venusLedsMask, &marsLedsMask};
+      const PixelMask * const earthspokelists[] = {&earthLedsMask, &earthAsVenusLedsMask, &earthAsMarsLedsMask};
+      const PixelMask *spokes[2] = {0};
 
       // omg matchmaking time
       do {
@@ -666,14 +1131,11 @@ public:
         spokes[1] = ARRAY_SAMPLE(planetspokelists);
       } while (spokes[0] == spokes[1]
               // don't show a single line on the spoke if part of it is suppressed
-              || (spokes[0] == &earthasvenusleds && earthVenusSuppressed)
-              || (spokes[0] == &earthasmarsleds && earthMarsSuppressed));
+              || (spokes[0] == &earthAsVenusLedsMask && earthVenusSuppressed)
+              || (spokes[0] == &earthAsMarsLedsMask && earthMarsSuppressed));
 
       for (int i = 0; i < 2; ++i) {
-        // FIXME: replace with the new constants from ledgraph?
-        allowedPixels[i].clear();
-        allowedPixels[i].insert(spokes[i]->begin(), spokes[i]->end());
-        allowedPixels[i].insert(circleleds.begin(), circleleds.end());
+        allowedPixels[i] = *spokes[i] | circleLedsMask;
 
         // pick a color/palette for each
         if (random8(2) == 0) {
@@ -784,11 +1246,13 @@ public:
 /* -------- */
 
 class ChargeSpokePattern : public SpokePattern {
+protected:
   BitsFiller *bitsFiller;
+private:
   void resetBitHandler() {
     bitsFiller->handleNewBit = [=](BitsFiller::Bit &bit) {
       static const int cutoffs[] = {circleIndexOppositeEarth, circleIndexOppositeVenus, circleIndexOppositeMars};
-      // we pick a spawn point, then figure out which direction is the shortest path to the spoke using cutoffs
+      // we pick a spawn point near the point opposite the spoke, then figure out which direction is the shortest path to the spoke
       // but add some fuzz to cause some bits fo travel around the point opposite the spoke too.
       int cutoff = cutoffs[spoke];
       int circleindex = mod_wrap(cutoff + random8()%6 - 3, circleleds.size());
@@ -796,7 +1260,10 @@ class ChargeSpokePattern : public SpokePattern {
       
       bit.px = circleleds[circleindex];
       
-      if ((unsigned)mod_wrap(circleindex - cutoff + directionFuzz, circleleds.size()) > circleleds.size() / 2) {
+      const HopDistances<NUM_LEDS> &clockwiseHops = hopDistances<EdgeType::clockwise>();
+      int clockwiseDistance = clockwiseHops.distance(bit.px, kSpokeJunctionLeds[spoke]);
+      int counterclockwiseDistance = clockwiseHops.distance(kSpokeJunctionLeds[spoke], bit.px);
+      if (counterclockwiseDistance + 2 * directionFuzz < clockwiseDistance) {
         bit.directions.edgeTypes.second = EdgeType::counterclockwise;
       } else {
         bit.directions.edgeTypes.second = EdgeType::clockwise;
@@ -809,11 +1276,10 @@ public:
     bitsFiller = new BitsFiller(ctx, 30, 50, 0, {EdgeType::outbound});
     bitsFiller->flowRule = BitsFiller::split;
     bitsFiller->splitDirections = EdgeType::outbound;
-    bitsFiller->fadeUpDistance = 2;
-    bitsFiller->fadeDown = 0;
+    bitsFiller->fade.setHalfLife(0);
     bitsFiller->maxBitsPerSecond = 25;
     bitsFiller->spawnRule = BitsFiller::maintainPopulation;
-    bitsFiller->allowedPixels = kSpokeCircleLedSets[spoke];
+    bitsFiller->allowedPixels = kSpokeCircleLedMasks[spoke];
 
     resetBitHandler();
   }
@@ -844,7 +1310,7 @@ class SparkleSpokePattern : public SpokePattern {
   std::vector<uint8_t> spawnIndexes;
 public:
   SparkleSpokePattern(EVMDrawingContext &ctx, EVMDrawingContext &subtractCtx, EVMColorManager &sharedColorManager, uint8_t spoke) : SpokePattern(ctx, subtractCtx, sharedColorManager, spoke) {
-    for (auto item : *(kSpokeCircleLedSets[spoke])) {
+    for (uint8_t item : *(kSpokeCircleLedMasks[spoke])) {
       spawnIndexes.push_back(item);
     }
   }
@@ -882,14 +1348,14 @@ public:
     }
   }
 
-  const vector<uint8_t>& ledList() {
+  PixelList ledList() {
     if (spoke == earth) {
       earthMarsSuppressed = (earthAs == mars);
       earthVenusSuppressed = (earthAs == venus);
-      const vector<uint8_t> * const earthspokelists[] = {&earthleds, &earthVenusOnly, &earthMarsOnly};
-      return *earthspokelists[earthAs];
+      const PixelList earthspokelists[] = {earthleds, earthVenusOnly, earthMarsOnly};
+      return earthspokelists[earthAs];
     } else {
-      return *kSpokeLedLists[spoke];
+      return kSpokeLedLists[spoke];
     }
   }
 
@@ -898,7 +1364,7 @@ public:
     if (start == 0) {
       start = millis();
     }
-    const vector<uint8_t>& leds = ledList();
+    const PixelList leds = ledList();
     unsigned long runTime = millis() - start;
     if (!fullRandom) { // visual indication that we're turning these pixels 'off', but only if manually triggered
       for (uint8_t index : leds) {
@@ -971,6 +1437,8 @@ class SpokePatternManager : public Pattern {
   bool useSharedPalettes[3] = {true, true, true};
 
   std::vector<SpokePattern * (*)(EVMDrawingContext&, EVMDrawingContext&, EVMColorManager&, uint8_t)> patternConstructors;
+  DecayTable fade = DecayTable(25); // both layers fade together
+
   template<class T>
   static SpokePattern *construct(EVMDrawingContext &ctx, EVMDrawingContext &subtractCtx, EVMColorManager &colorManager, uint8_t spoke) {
     return new T(ctx, subtractCtx, colorManager, spoke);
@@ -991,6 +1459,14 @@ public:
 
   EVMDrawingContext subtractCtx;
 
+  // Spokes brighten whatever's under them, then suppressed pixels are darkened. The compositor's stack needs
+  // blendBrighten and blendSubtract layers from first.
+  template<class C>
+  void attachLayers(C &compositor, uint8_t first) {
+    compositor.layers[first].source = &ctx;
+    compositor.layers[first + 1].source = &subtractCtx;
+  }
+
   SpokePatternManager() {
     patternConstructors.push_back(&(construct<ChargeSpokePattern>));
     patternConstructors.push_back(&(construct<SparkleSpokePattern>));
@@ -1090,12 +1566,14 @@ public:
   }
 
   void update() {
-    ctx.leds.fadeToBlackBy(5 * frameTime());
-    subtractCtx.leds.fadeToBlackBy(5 * frameTime());
+    decayContexts(fade.factor(frameTime()), ctx, subtractCtx);
 
     for (int spoke = 0; spoke < 3; ++spoke) {
       if (spokePatterns[spoke]) {
         spokePatterns[spoke]->update();
+        // spoke patterns draw straight into the shared buffers, once every spoke is idle they fade out and get skipped
+        ctx.markDirty();
+        subtractCtx.markDirty();
         if (spokePatterns[spoke]->isIdle()) {
           teardownSpoke(spoke);
         }
@@ -1113,30 +1591,24 @@ public:
 class IntersexFlagPattern : public Pattern {
   BitsFiller outerBits;
   BitsFiller innerBits;
-  std::set<uint8_t> spokePixels;
+  DecayTable fade = DecayTable(32);
 public:
   IntersexFlagPattern() : outerBits(ctx, 20, 40, 4000, {EdgeType::inbound}), 
                           innerBits(ctx, 8, 40, 4000, {EdgeType::clockwise | EdgeType::counterclockwise}) {
-    spokePixels.insert(earthleds.begin(), earthleds.end());
-    spokePixels.insert(venusleds.begin(), venusleds.end());
-    spokePixels.insert(marsleds.begin(), marsleds.end());
-
-    outerBits.allowedPixels = &spokePixels; // keeps pixels from following the last inbound edge onto the circle
-    outerBits.spawnPixels = &leafleds;
-    outerBits.fadeUpDistance = 2;
-    outerBits.fadeDown = 0;
+    outerBits.allowedPixels = &spokeLedsMask; // keeps pixels from following the last inbound edge onto the circle
+    outerBits.spawnPixels = &leafLedsMask;
+    outerBits.fade.setHalfLife(0);
     outerBits.maxBitsPerSecond = 30;
 
-    innerBits.spawnPixels = &circleleds;
-    innerBits.fadeUpDistance = 2;
-    innerBits.fadeDown = 0;
+    innerBits.spawnPixels = &circleLedsMask;
+    innerBits.fade.setHalfLife(0);
     innerBits.maxBitsPerSecond = 8;
   }
 
   unsigned long lastColorShift = 0;
 
   void update() {
-    ctx.leds.fadeToBlackBy(4 * frameTime());
+    decayContexts(fade.factor(frameTime()), ctx);
 
     outerBits.update();
     innerBits.update();
@@ -1180,10 +1652,12 @@ public:
     };
 
     // change bit colors for the new palette immediately for better feedback
-    for (BitsFiller::Bit &bit : outerBits.bits) {
+    for (uint8_t b = 0; b < outerBits.bits.size(); ++b) {
+      BitsFiller::Bit bit = outerBits.bits[b];
       bit.color = colorForBit(bit, &outerBits);
     }
-    for (BitsFiller::Bit &bit : innerBits.bits) {
+    for (uint8_t b = 0; b < innerBits.bits.size(); ++b) {
+      BitsFiller::Bit bit = innerBits.bits[b];
       bit.color = colorForBit(bit, &innerBits);
     }
   }
@@ -1198,26 +1672,24 @@ public:
 class SoundBits : public Pattern, public FFTProcessing {
   BitsFiller bitsFillerOut;
   BitsFiller bitsFillerIn;
+  DecayTable fade = DecayTable(32);
 public:
   SoundBits() : bitsFillerOut(ctx, 0, 60, 1200, {EdgeType::outbound, EdgeType::clockwise | EdgeType::counterclockwise}),
                 bitsFillerIn(ctx, 0, 60, 1200, {EdgeType::inbound, EdgeType::clockwise | EdgeType::counterclockwise}) {
-    bitsFillerOut.flowRule = BitsFiller::random;
-    bitsFillerOut.fadeUpDistance = 3;
-    bitsFillerOut.spawnPixels = &circleleds;
-    bitsFillerOut.fadeDown = 0;
-    bitsFillerOut.handleUpdateBit = [](BitsFiller::Bit &bit) {
+    auto fadeWithAge = [](BitsFiller::Bit &bit) {
       int raw = min(0xFF, max(0, (int)(0xFF - 0xFF * bit.age() / bit.lifespan)));
       bit.brightness = raw;
     };
 
+    bitsFillerOut.flowRule = BitsFiller::random;
+    bitsFillerOut.spawnPixels = &circleLedsMask;
+    bitsFillerOut.fade.setHalfLife(0);
+    bitsFillerOut.handleUpdateBit = fadeWithAge;
+
     bitsFillerIn.flowRule = BitsFiller::random;
-    bitsFillerIn.fadeUpDistance = 3;
-    bitsFillerIn.spawnPixels = &leafleds;
-    bitsFillerOut.fadeDown = 0;
-    bitsFillerIn.handleUpdateBit = [](BitsFiller::Bit &bit) {
-      int raw = min(0xFF, max(0, (int)(0xFF - 0xFF * bit.age() / bit.lifespan)));
-      bit.brightness = raw;
-    };
+    bitsFillerIn.spawnPixels = &leafLedsMask;
+    bitsFillerIn.fade.setHalfLife(0);
+    bitsFillerIn.handleUpdateBit = fadeWithAge;
   }
 
   void colorModeChanged() {
@@ -1232,7 +1704,7 @@ public:
   unsigned long lastThreshAdjust = 0;
 
   void update() {
-    ctx.leds.fadeToBlackBy(4 * frameTime());
+    decayContexts(fade.factor(frameTime()), ctx);
 
     FFTFrame fftFrame = fftUpdate();
     // fftLog(spectrum);
@@ -1244,7 +1716,7 @@ public:
           // loglf("levels[%i]: %i; making a bit; out bits = %u, in bits = %u...", b, spectrum[b], bitsFillerOut.bits.size(), bitsFillerIn.bits.size());
           bool spawnoutbound = freqBucket < fftFrame.size / 5;
           unsigned maxlifespan = spawnoutbound ? 2000 : 1000;
-          BitsFiller::Bit &bit = (spawnoutbound ? bitsFillerOut : bitsFillerIn).addBit();
+          BitsFiller::Bit bit = (spawnoutbound ? bitsFillerOut : bitsFillerIn).addBit();
           bit.lifespan = min(maxlifespan, maxlifespan * (fftFrame.spectrum[freqBucket]-soundThreshold)/20);
           // logf("done");                                                  
 
@@ -1284,8 +1756,7 @@ class SoundTest : public Pattern, public FFTProcessing {
 public:
   SoundTest() : bitsFiller(ctx, 0, 60, 1200, {EdgeType::outbound, EdgeType::clockwise | EdgeType::counterclockwise}) {
     bitsFiller.flowRule = BitsFiller::random;
-    bitsFiller.fadeUpDistance = 3;
-    bitsFiller.spawnPixels = &circleleds;
+    bitsFiller.spawnPixels = &circleLedsMask;
     bitsFiller.handleUpdateBit = [](BitsFiller::Bit &bit) {
       int raw = min(0xFF, max(0, (int)(0xFF - 0xFF * bit.age() / bit.lifespan)));
       bit.brightness = raw;
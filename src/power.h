@@ -6,6 +6,7 @@
 #include "wiring_private.h" // pinPeripheral() function
 #include "util.h"
 #include "ledgraph.h"
+#include "ledoutput.h"
 
 #define THERMISTOR_PIN A4       // PA05
 #define THERMISTOR_POWER_PIN 16 // PB09
@@ -207,8 +208,8 @@ public:
         int pot = adcRead;
         FastLED.setBrightness(0xFF * pot/4096.);
       }
-      FastLED.show();
-      FastLED.delay(16);
+      ledOutput.show();
+      delay(16);
     }
   }
 
@@ -219,8 +220,8 @@ public:
       for (int c : circleleds) {
         leds[c] = CHSV(0, 0xFF, i * 0xFF / fadeUpFrames);
       }
-      FastLED.show();
-      FastLED.delay(16);
+      ledOutput.show();
+      delay(16);
       if (!sleepPending) {
         break;
       }
@@ -239,8 +240,8 @@ public:
         leds[circleleds[c]] = CHSV(0, 0xFF, lerp16by16(0xFF, 80, progress));
       }
 
-      FastLED.show();
-      FastLED.delay(16);
+      ledOutput.show();
+      delay(16);
       if (!sleepPending) {
         break;
       }
@@ -360,7 +361,7 @@ public:
       }
       if (sleepPending) { // if sleep hasn't been cancelled
         FastLED.setBrightness(0);
-        FastLED.show();
+        ledOutput.show();
         listen_for_adc_interrupt();
 
         assert(sleeping, "should have just been asleep");
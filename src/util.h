@@ -98,18 +98,6 @@ inline float fmod_wrap(float x, int m) {
   return result < 0 ? result + m : result;
 }
 
-void DrawModal(int fps, unsigned long durationMillis, std::function<void(unsigned long elapsed)> tick) {
-  int delayMillis = 1000/fps;
-  unsigned long start = millis();
-  unsigned long elapsed = 0;
-  do {
-    tick(elapsed);
-    FastLED.show();
-    FastLED.delay(delayMillis);
-    elapsed = millis() - start;
-  } while (elapsed < durationMillis);
-}
-
 class FrameCounter {
   private:
     unsigned long lastPrint = 0;
@@ -135,7 +123,7 @@ class FrameCounter {
     void clampToFramerate(int fps) {
       int delayms = 1000 / fps - (millis() - lastClamp);
       if (delayms > 0) {
-        FastLED.delay(delayms);
+        delay(delayms);
       }
       lastClamp = millis();
     }
@@ -0,0 +1,20 @@
+#ifndef ADAFRUIT_FREETOUCH_STUB_H
+#define ADAFRUIT_FREETOUCH_STUB_H
+
+#define OVERSAMPLE_4 4
+#define RESISTOR_50K 50
+#define RESISTOR_0 0
+#define FREQ_MODE_NONE 0
+
+typedef int oversample_t;
+typedef int series_resistor_t;
+typedef int freq_mode_t;
+
+// never touched
+struct Adafruit_FreeTouch {
+  Adafruit_FreeTouch(int, int, int, int) { }
+  bool begin() { return true; }
+  int measure() { return 0; }
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef ADAFRUIT_ZEROI2S_STUB_H
+#define ADAFRUIT_ZEROI2S_STUB_H
+
+#define I2S_32_BIT 32
+
+struct Adafruit_ZeroI2S {
+  bool begin(int, int) { return true; }
+  void enableRx() { }
+  void disableRx() { }
+  bool rxReady() { return true; }
+  void read(int32_t *left, int32_t *right) { *left = 1; *right = 1; }
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef ARDUINO_STUB_H
+#define ARDUINO_STUB_H
+
+// Just enough of the Arduino core to build the firmware headers on the host for the native tests. The clock only moves
+// when a test moves it, through delay() or g_millis.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+#define ARDUINO 10813
+
+// the SAMD core's min and max, which the firmware #undefs
+template<class T, class L> auto min(const T& a, const L& b) -> decltype((b < a) ? b : a) { return (b < a) ? b : a; }
+template<class T, class L> auto max(const T& a, const L& b) -> decltype((b < a) ? b : a) { return (a < b) ? b : a; }
+
+// newlib on the SAMD21 doesn't declare vasprintf so util.h brings its own, glibc does
+#define vasprintf evm_vasprintf
+
+inline char *__brkval = NULL; // for freeRAM()
+
+inline uint32_t g_millis = 0;
+inline uint32_t millis() { return g_millis; }
+inline uint32_t micros() { return g_millis * 1000; }
+inline void delay(unsigned long ms) { g_millis += ms; }
+
+inline int analogRead(int) { return 0; }
+inline void pinMode(int, int) { }
+inline void digitalWrite(int, int) { }
+inline int digitalRead(int) { return 1; }
+inline long random(long m) { return rand() % m; }
+inline void randomSeed(unsigned long s) { srand(s); }
+
+#define INPUT_PULLUP 2
+#define INPUT_PULLDOWN 3
+#define OUTPUT 1
+#define HIGH 1
+#define LOW 0
+#define A0 14
+#define A1 15
+#define A4 18
+#define PORTA 0
+
+struct SerialStub {
+  void print(const char *s) { fputs(s, stdout); }
+  void print(int v) { printf("%d", v); }
+  void println(const char *s = "") { puts(s); }
+  void flush() { }
+  void begin(int) { }
+  operator bool() { return true; }
+};
+
+inline SerialStub Serial;
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef FASTLED_STUB_H
+#define FASTLED_STUB_H
+
+// The parts of FastLED the firmware uses, for the native tests. The integer math follows FastLED's fixed-scale versions.
+// Color conversions are not FastLED's: CHSV to CRGB only needs to be deterministic here, and palettes take one color
+// per entry without interpolating.
+
+#include "Arduino.h"
+#include <stdint.h>
+
+typedef uint8_t fract8;
+
+inline uint8_t scale8(uint8_t i, uint8_t s) { return ((uint16_t)i * (1 + (uint16_t)s)) >> 8; }
+inline uint8_t scale8_video(uint8_t i, uint8_t s) { return (((int)i * (int)s) >> 8) + ((i && s) ? 1 : 0); }
+inline uint16_t scale16(uint16_t i, uint16_t s) { return ((uint32_t)i * (1 + (uint32_t)s)) >> 16; }
+inline uint8_t dim8_raw(uint8_t x) { return scale8(x, x); }
+inline uint8_t qadd8(uint8_t a, uint8_t b) { int t = a + b; return t > 255 ? 255 : t; }
+inline uint8_t qsub8(uint8_t a, uint8_t b) { int t = a - b; return t < 0 ? 0 : t; }
+inline uint8_t addmod8(uint8_t a, uint8_t b, uint8_t m) { a += b; while (a >= m) a -= m; return a; }
+inline uint8_t lerp8by8(uint8_t a, uint8_t b, fract8 f) { return b > a ? a + scale8(b - a, f) : a - scale8(a - b, f); }
+inline uint16_t lerp16by16(uint16_t a, uint16_t b, uint16_t f) { return b > a ? a + scale16(b - a, f) : a - scale16(a - b, f); }
+inline uint16_t ease16InOutQuad(uint16_t i) { return i; }
+inline int16_t sin16(uint16_t theta) { return (int16_t)(sin(theta * 2 * M_PI / 65536.) * 32767); }
+inline uint8_t sin8(uint8_t theta) { return (uint8_t)(128 + sin(theta * 2 * M_PI / 256.) * 127); }
+
+inline uint16_t rand16seed = 1337;
+inline uint8_t random8() { rand16seed = rand16seed * 2053 + 13849; return (uint8_t)((rand16seed & 0xFF) + (rand16seed >> 8)); }
+inline uint8_t random8(uint8_t lim) { return (random8() * lim) >> 8; }
+inline uint8_t random8(uint8_t mn, uint8_t lim) { return mn + random8(lim - mn); }
+inline uint16_t random16() { rand16seed = rand16seed * 2053 + 13849; return rand16seed; }
+inline uint16_t random16(uint16_t lim) { return ((uint32_t)random16() * lim) >> 16; }
+inline void random16_add_entropy(uint16_t e) { rand16seed += e; }
+inline void random16_set_seed(uint16_t s) { rand16seed = s; }
+inline uint16_t random16_get_seed() { return rand16seed; }
+
+inline uint8_t beatsin8(uint16_t bpm, uint8_t lo = 0, uint8_t hi = 255, uint32_t tb = 0, uint8_t po = 0) {
+  return lo + scale8(sin8(millis() * bpm / 235 + po), hi - lo);
+}
+
+struct CHSV {
+  union {
+    struct { uint8_t h, s, v; };
+    uint8_t raw[3];
+  };
+  CHSV() { }
+  CHSV(uint8_t h, uint8_t s, uint8_t v) : h(h), s(s), v(v) { }
+};
+
+struct CRGB {
+  union {
+    struct {
+      union { uint8_t r; uint8_t red; };
+      union { uint8_t g; uint8_t green; };
+      union { uint8_t b; uint8_t blue; };
+    };
+    uint8_t raw[3];
+  };
+  typedef enum { Black = 0x000000, White = 0xFFFFFF, Red = 0xFF0000 } HTMLColorCode;
+
+  CRGB() { }
+  CRGB(uint8_t r, uint8_t g, uint8_t b) : r(r), g(g), b(b) { }
+  CRGB(uint32_t c) : r(c >> 16), g(c >> 8), b(c) { }
+  CRGB(HTMLColorCode c) : r(c >> 16), g(c >> 8), b(c) { }
+  CRGB(const CHSV &hsv) { r = hsv.v; g = scale8(hsv.v, 255 - hsv.s); b = hsv.h; }
+  CRGB &operator=(const CHSV &hsv) { *this = CRGB(hsv); return *this; }
+
+  uint8_t &operator[](uint8_t x) { return raw[x]; }
+  const uint8_t &operator[](uint8_t x) const { return raw[x]; }
+
+  CRGB &nscale8(uint8_t s) { r = scale8(r, s); g = scale8(g, s); b = scale8(b, s); return *this; }
+  CRGB &nscale8_video(uint8_t s) { r = scale8_video(r, s); g = scale8_video(g, s); b = scale8_video(b, s); return *this; }
+  CRGB &fadeToBlackBy(uint8_t f) { return nscale8(255 - f); }
+  CRGB &operator+=(const CRGB &o) { r = qadd8(r, o.r); g = qadd8(g, o.g); b = qadd8(b, o.b); return *this; }
+  CRGB &operator-=(const CRGB &o) { r = qsub8(r, o.r); g = qsub8(g, o.g); b = qsub8(b, o.b); return *this; }
+  CRGB &operator|=(const CRGB &o) { r = max(r, o.r); g = max(g, o.g); b = max(b, o.b); return *this; }
+  CRGB &operator&=(const CRGB &o) { r = min(r, o.r); g = min(g, o.g); b = min(b, o.b); return *this; }
+  uint8_t getAverageLight() const { return (r + g + b) / 3; }
+  explicit operator bool() const { return r || g || b; }
+  bool operator==(const CRGB &o) const { return r == o.r && g == o.g && b == o.b; }
+  bool operator!=(const CRGB &o) const { return !(*this == o); }
+};
+
+inline CRGB operator-(const CRGB &a, const CRGB &b) { CRGB r = a; r -= b; return r; }
+inline CRGB operator+(const CRGB &a, const CRGB &b) { CRGB r = a; r += b; return r; }
+
+inline CRGB blend(const CRGB &a, const CRGB &b, fract8 amt) {
+  CRGB r;
+  for (int i = 0; i < 3; ++i) {
+    r.raw[i] = lerp8by8(a.raw[i], b.raw[i], amt);
+  }
+  return r;
+}
+
+inline CRGB &nblend(CRGB &a, const CRGB &b, fract8 amt) { a = blend(a, b, amt); return a; }
+
+template <int SIZE>
+struct CRGBArray {
+  CRGB entries[SIZE];
+  CRGB &operator[](int x) { return entries[x]; }
+  const CRGB &operator[](int x) const { return entries[x]; }
+  int size() const { return SIZE; }
+  operator CRGB *() { return entries; }
+  CRGBArray &fill_solid(const CRGB &c) { for (auto &e : entries) e = c; return *this; }
+  CRGBArray &fadeToBlackBy(uint8_t f) { for (auto &e : entries) e.fadeToBlackBy(f); return *this; }
+  CRGBArray &nscale8(uint8_t s) { for (auto &e : entries) e.nscale8(s); return *this; }
+  CRGB *begin() { return entries; }
+  CRGB *end() { return entries + SIZE; }
+};
+
+typedef const uint8_t TProgmemRGBGradientPalette_byte;
+typedef const TProgmemRGBGradientPalette_byte *TProgmemRGBGradientPalette_bytes;
+typedef TProgmemRGBGradientPalette_bytes TProgmemRGBGradientPaletteRef;
+typedef union { struct { uint8_t index, r, g, b; }; uint32_t dword; uint8_t bytes[4]; } TRGBGradientPaletteEntryUnion;
+#define FL_PGM_READ_DWORD_NEAR(x) (*((const uint32_t *)(x)))
+#define DEFINE_GRADIENT_PALETTE(X) extern const TProgmemRGBGradientPalette_byte X[] =
+
+template <int N>
+struct CRGBPaletteN {
+  CRGB entries[N];
+  CRGBPaletteN() { }
+  CRGBPaletteN(TProgmemRGBGradientPaletteRef p) { for (int i = 0; i < N; ++i) entries[i] = CRGB(p[1], p[2], p[3]); }
+  CRGBPaletteN &operator=(TProgmemRGBGradientPaletteRef p) { *this = CRGBPaletteN(p); return *this; }
+};
+
+typedef CRGBPaletteN<16> CRGBPalette16;
+typedef CRGBPaletteN<32> CRGBPalette32;
+typedef CRGBPaletteN<256> CRGBPalette256;
+
+template <int N>
+CRGB ColorFromPalette(const CRGBPaletteN<N> &p, uint8_t i, uint8_t br = 255) {
+  CRGB c = p.entries[i * N / 256];
+  c.nscale8(br);
+  return c;
+}
+
+#define EVERY_N_MILLISECONDS(n) for (bool _once = (millis() % (n)) == 0; _once; _once = false)
+#define EVERY_N_SECONDS(n) EVERY_N_MILLISECONDS((n) * 1000)
+
+enum EOrder { RGB = 0012, BGR = 0210 };
+enum ESPIChipsets { APA102, SK9822 };
+
+struct CFastLED {
+  uint8_t bright = 255;
+  void show() { }
+  void delay(unsigned long ms) { ::delay(ms); }
+  void setBrightness(uint8_t b) { bright = b; }
+  uint8_t getBrightness() { return bright; }
+};
+
+inline CFastLED FastLED;
+
+#endif
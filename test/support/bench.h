@@ -0,0 +1,32 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <stdio.h>
+
+// Host timing for the benchmarks in test/. The numbers say nothing absolute about the SAMD21, only compare them to each other
+// within one run. Each measurement is the best of a few runs so a preempted run doesn't count.
+
+// sink for benchmark results so the optimizer can't drop the work that made them
+inline volatile uint32_t benchSink;
+
+// nanoseconds per call of body(), best of runs of reps calls each
+template <class Body>
+double benchNanos(unsigned reps, Body body, unsigned runs=5) {
+  double best = 0;
+  for (unsigned r = 0; r < runs; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < reps; ++i) {
+      body();
+    }
+    double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / reps;
+    if (r == 0 || nanos < best) {
+      best = nanos;
+    }
+  }
+  return best;
+}
+
+#define benchf(fmt, ...) printf("bench: " fmt "\n", ##__VA_ARGS__)
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef RINGLAYOUTS_H
+#define RINGLAYOUTS_H
+
+#include "ledgraph.h"
+
+// Rings of LEDs at the sizes the scaling benchmarks compare, the same size as this board and bigger derivatives of it.
+// A ring has one edge per LED, so only the LED count changes between them.
+
+template <unsigned LEDCount>
+inline constexpr StripEdgeList<LEDCount, true> kRingEdges = MakeStripEdges<LEDCount, true>();
+
+template <unsigned LEDCount>
+inline constexpr CSRGraph<LEDCount, LEDCount> ringGraph = MakeCSRGraph<LEDCount>(kRingEdges<LEDCount>.edges);
+
+template <unsigned LEDCount>
+using RingLayout = BoardLayout<LEDCount, CSRGraph<LEDCount, LEDCount>, ringGraph<LEDCount>>;
+
+#endif
@@ -0,0 +1,591 @@
+#include <Arduino.h>
+#include <FastLED.h>
+#include <unity.h>
+
+bool fullRandom = false;
+
+#include "util.h"
+#include "drawing.h"
+#include "patterns.h"
+#include "ledoutput.h"
+
+#include "bench.h"
+#include "ringlayouts.h"
+
+typedef BasicBitsFiller<FixedFlow<BitsFillerBase::split>, FixedSpawn<BitsFillerBase::manualSpawn>> SplitFiller;
+
+EVMDrawingContext ctx;
+EVMLEDOutput ledOutput;
+
+void setUp() {
+  g_millis = 1000;
+  random16_set_seed(1337);
+  ctx.leds.fill_solid(CRGB::Black);
+}
+void tearDown() { }
+
+// one bit heading outbound from px, drawn once so it's ready to flow
+static void placeBit(SplitFiller &filler, uint8_t px) {
+  filler.fade = DecayTable(0);
+  filler.mergeCollisions = false;
+  filler.addBit().px = px;
+  filler.update(g_millis);
+}
+
+// 14 branches three ways outbound, to 15 down the spoke and to 27 and 28 on the earth cross
+static void assertSplitInStep(uint8_t from, uint16_t step, const uint8_t (&expected)[3]) {
+  SplitFiller filler(ctx, 0, 10, 0, {EdgeType::outbound});
+  placeBit(filler, from);
+  // 10 pixels/second, step is in Q8.8 pixels
+  g_millis += step * 1000 / (10 * 0x100);
+  filler.update(g_millis);
+
+  TEST_ASSERT_EQUAL_UINT8(3, filler.bits.size());
+  for (uint8_t b = 0; b < filler.bits.size(); ++b) {
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(filler.bits.phase[0], filler.bits.phase[b], "split copy out of step with its parent");
+    TEST_ASSERT_EQUAL_UINT8(step & 0xFF, filler.bits.phase[b]);
+    bool found = false;
+    for (uint8_t px : expected) {
+      found |= filler.bits.px[b] == px;
+    }
+    TEST_ASSERT_TRUE(found);
+  }
+}
+
+void test_split_copies_keep_parent_phase() {
+  // arrives at the junction and goes half a pixel on
+  const uint8_t expected[] = {14, 14, 14};
+  assertSplitInStep(13, 0x180, expected);
+}
+
+void test_split_copies_finish_the_step() {
+  // splits at 14 with a pixel and a half still to go, each copy has to travel it too
+  const uint8_t expected[] = {15, 27, 28};
+  assertSplitInStep(13, 0x280, expected);
+}
+
+// Bits that were already on the board when the step began have been through mergeHeadings, so no two of them should be
+// left on the same pixel headed down the same edge with the same directions for the same emitter. Counts those that are.
+template <class Filler>
+static uint8_t sharedHeadings(Filler &filler, unsigned long stepBegan) {
+  auto &bits = filler.bits;
+  uint8_t shared = 0;
+  for (uint8_t a = 0; a < bits.size(); ++a) {
+    if (bits.birthmilli[a] >= stepBegan) {
+      continue;
+    }
+    for (uint8_t b = 0; b < a; ++b) {
+      if (bits.birthmilli[b] < stepBegan && bits.px[b] == bits.px[a] && bits.nextPx[b] == bits.nextPx[a]
+          && bits.directions[b].pair == bits.directions[a].pair && bits.emitter[b] == bits.emitter[a]) {
+        ++shared;
+        break;
+      }
+    }
+  }
+  return shared;
+}
+
+struct PopulationStats {
+  uint8_t peak = 0;
+  uint8_t peakShared = 0; // most bits sharing a heading in any one frame
+};
+
+// population over a simulated minute at about 110fps
+template <class Frame, class Filler>
+static PopulationStats populationStats(Frame frame, Filler &filler) {
+  PopulationStats stats;
+  for (unsigned f = 0; f < 60 * 110; ++f) {
+    g_millis += 9;
+    unsigned long stepBegan = filler.bits.now;
+    frame();
+    stats.peak = MAX(stats.peak, filler.bits.size());
+    stats.peakShared = MAX(stats.peakShared, sharedHeadings(filler, stepBegan));
+  }
+  return stats;
+}
+
+template <class Frame, class Filler>
+static uint8_t peakPopulation(Frame frame, Filler &filler) {
+  return populationStats(frame, filler).peak;
+}
+
+// two bits a frame dropped on the same pixel, all headed clockwise around the circle
+static uint8_t peakCirclingPopulation(bool merge) {
+  BitsFiller filler(ctx, 0, 30, 0, {EdgeType::clockwise}, 128);
+  filler.spawnRule = BitsFiller::manualSpawn;
+  filler.mergeCollisions = merge;
+  return peakPopulation([&]() {
+    for (int i = 0; i < 2 && !filler.bits.full(); ++i) {
+      filler.addBit().px = circleleds[0];
+    }
+    filler.update(g_millis);
+  }, filler);
+}
+
+void test_merging_bounds_population() {
+  uint8_t before = peakCirclingPopulation(false);
+  uint8_t after = peakCirclingPopulation(true);
+  printf("circling bits peak population: %u unmerged, %u merged\n", before, after);
+  TEST_ASSERT_EQUAL_UINT8(128, before);
+  // a bit per circle edge, plus the two that haven't flowed yet
+  TEST_ASSERT_LESS_OR_EQUAL(circleleds.size() + 2, after);
+}
+
+// Runs a pattern for a minute as run(merge) sets it up, without merging and then with it from the same seed. Merging mustn't
+// add bits, and must leave no two bits on the same heading.
+template <class Run>
+static void assertMergingBounds(const char *name, Run run) {
+  random16_set_seed(1337);
+  g_millis = 1000;
+  PopulationStats before = run(false);
+  random16_set_seed(1337);
+  g_millis = 1000;
+  PopulationStats after = run(true);
+  printf("%s peak population: %u unmerged with up to %u sharing a heading, %u merged\n", name, before.peak, before.peakShared, after.peak);
+  TEST_ASSERT_LESS_OR_EQUAL(before.peak, after.peak);
+  TEST_ASSERT_EQUAL_UINT8(0, after.peakShared);
+}
+
+struct TestDownstreamPattern : public DownstreamPattern {
+  using DownstreamPattern::bitsFiller;
+};
+
+void test_downstream_population() {
+  assertMergingBounds("downstream", [](bool merge) {
+    EVMColorManager colorManager;
+    TestDownstreamPattern pattern;
+    pattern.colorManager = &colorManager;
+    pattern.colorModeChanged();
+    pattern.bitsFiller->mergeCollisions = merge;
+    pattern.start();
+    return populationStats([&]() { pattern.loop(); }, *pattern.bitsFiller);
+  });
+}
+
+struct TestHeartBeatPattern : public HeartBeatPattern {
+  using HeartBeatPattern::pumpFiller;
+};
+
+void test_heartbeat_population() {
+  assertMergingBounds("heartbeat", [](bool merge) {
+    EVMColorManager colorManager;
+    TestHeartBeatPattern pattern;
+    pattern.colorManager = &colorManager;
+    pattern.colorModeChanged();
+    pattern.pumpFiller.mergeCollisions = merge;
+    pattern.start();
+    return populationStats([&]() { pattern.loop(); }, pattern.pumpFiller);
+  });
+}
+
+struct TestChargeSpokePattern : public ChargeSpokePattern {
+  using ChargeSpokePattern::ChargeSpokePattern;
+  using ChargeSpokePattern::bitsFiller;
+};
+
+void test_chargespoke_population() {
+  for (uint8_t spoke = 0; spoke < 3; ++spoke) {
+    assertMergingBounds("chargespoke", [spoke](bool merge) {
+      EVMColorManager colorManager;
+      EVMDrawingContext subtractCtx;
+      TestChargeSpokePattern pattern(ctx, subtractCtx, colorManager, spoke);
+      pattern.bitsFiller->mergeCollisions = merge;
+      pattern.setActive(true);
+      return populationStats([&]() { pattern.update(); }, *pattern.bitsFiller);
+    });
+  }
+}
+
+// Runs a fixed-step filler for a second, calling update() after each of gaps in turn but never past a checkpoint, so
+// every schedule lands on the same 100ms boundaries. Returns the frame at each of them.
+template <size_t GapCount>
+static vector<CRGBArray<NUM_LEDS>> framesAtCheckpoints(const uint8_t (&gaps)[GapCount]) {
+  random16_set_seed(1337);
+  ctx.clear();
+  BitsFiller filler(ctx, 20, 40, 600, {EdgeType::clockwise | EdgeType::counterclockwise, EdgeType::outbound});
+  filler.fixedStepMillis = 10;
+  unsigned long now = g_millis;
+  vector<CRGBArray<NUM_LEDS>> frames;
+  for (unsigned checkpoint = 1; checkpoint <= 10; ++checkpoint) {
+    unsigned long at = g_millis + 100 * checkpoint;
+    for (unsigned g = 0; now < at; ++g) {
+      now = MIN(now + gaps[g % GapCount], at);
+      filler.update(now);
+    }
+    frames.push_back(ctx.leds);
+  }
+  return frames;
+}
+
+void test_fixed_step_frames_ignore_jitter() {
+  // one loop stalling up to two steps at a time, the other running a little either side of the step
+  const uint8_t stalling[] = {3, 17, 9, 21, 1, 12, 6};
+  const uint8_t steady[] = {11, 8, 13, 9};
+  vector<CRGBArray<NUM_LEDS>> a = framesAtCheckpoints(stalling);
+  vector<CRGBArray<NUM_LEDS>> b = framesAtCheckpoints(steady);
+  for (unsigned f = 0; f < a.size(); ++f) {
+    bool lit = false;
+    for (unsigned i = 0; i < NUM_LEDS; ++i) {
+      lit |= (bool)a[f][i];
+    }
+    TEST_ASSERT_TRUE(lit);
+    TEST_ASSERT_EQUAL_MEMORY(&a[f][0], &b[f][0], NUM_LEDS * sizeof(CRGB));
+  }
+}
+
+// cost of one filler step, with bits dying of old age and respawning as they go
+static double nanosPerStep(uint8_t population) {
+  BitsFiller filler(ctx, population, 30, 400, {EdgeType::clockwise | EdgeType::counterclockwise}, population);
+  filler.flowRule = BitsFiller::random;
+  filler.mergeCollisions = false; // hold the population where it's set
+  filler.update(g_millis);
+  return benchNanos(2000, [&]() {
+    g_millis += 8;
+    filler.update(g_millis);
+  });
+}
+
+void test_bench_update_cost_flat_in_population() {
+  const uint8_t populations[] = {10, 100, 250};
+  double nanos[ARRAY_SIZE(populations)];
+  for (unsigned i = 0; i < ARRAY_SIZE(populations); ++i) {
+    nanos[i] = nanosPerStep(populations[i]);
+    benchf("filler step with %3u bits: %8.1f ns, %6.1f ns/bit", populations[i], nanos[i], nanos[i] / populations[i]);
+  }
+  // what each extra bit costs, low and high. storage that shifted or reallocated on removal costs more the more bits
+  // there are to move, so the high end would climb. the step's fixed costs cancel out of both.
+  double marginalLow = (nanos[1] - nanos[0]) / (populations[1] - populations[0]);
+  double marginalHigh = (nanos[2] - nanos[1]) / (populations[2] - populations[1]);
+  benchf("marginal cost per bit: %.1f ns from %u to %u bits, %.1f ns from %u to %u", marginalLow, populations[0], populations[1],
+    marginalHigh, populations[1], populations[2]);
+  TEST_ASSERT_TRUE(marginalHigh < 1.5 * marginalLow);
+}
+
+// A bit as BitsFiller stored them before BitPool, one struct per bit in a vector
+struct AoSBit {
+  unsigned long birthmilli;
+  bool firstFrame;
+  uint8_t colorIndex;
+  BitsFiller::PixelIndex px;
+  EdgeTypesPair directions;
+  unsigned long lifespan;
+  CRGB color;
+  uint8_t brightness;
+  BitsFiller::PixelIndex nextPx;
+  uint8_t phase;
+
+  unsigned long age() {
+    return millis() - birthmilli;
+  }
+};
+
+// BitsFiller's step as it was laid out before BitPool: bits in a vector, a std::function update handler, and a pass over
+// the bits for each stage. Covers what the bench needs, bits following a single next hop, so it's a lean floor for the old
+// code: no flow rule dispatch, no allowed pixels and no replanning after pattern code moves a bit.
+struct AoSFiller {
+  vector<AoSBit> bits;
+  DecayTable fade = DecayTable(32);
+  uint8_t speed;
+  unsigned long now;
+  unsigned long phaseRemainder = 0;
+  function<void(AoSBit &)> handleUpdateBit;
+
+  AoSFiller(const BitsFiller &filler) : speed(filler.speed), now(filler.bits.now) {
+    const BitsFiller::BitPool &p = filler.bits;
+    for (uint8_t b = 0; b < p.size(); ++b) {
+      bits.push_back({p.birthmilli[b], p.firstFrame[b], p.colorIndex[b], p.px[b], p.directions[b], p.lifespan[b], p.color[b], p.brightness[b], nextHop(p.px[b], p.directions[b]), p.phase[b]});
+    }
+  }
+
+  static BitsFiller::PixelIndex nextHop(BitsFiller::PixelIndex px, EdgeTypesPair directions) {
+    NextHops next;
+    ledgraph.nextHops(px, directions, next);
+    return next.count ? next.px[0] : BitsFiller::NoPixel;
+  }
+
+  void update(unsigned long mils) {
+    unsigned long elapsed = mils - now;
+    now = mils;
+    ctx.decay(fade.factor(elapsed));
+
+    phaseRemainder += MIN(elapsed, 1000ul) * speed * 0x100;
+    uint16_t step = phaseRemainder / 1000;
+    phaseRemainder %= 1000;
+    for (int i = bits.size() - 1; i >= 0; --i) {
+      AoSBit &bit = bits[i];
+      if (bit.firstFrame) {
+        continue;
+      }
+      uint16_t phase = bit.phase + step;
+      for (; phase > 0xFF; phase -= 0x100) {
+        bit.px = bit.nextPx;
+        bit.nextPx = nextHop(bit.px, bit.directions);
+      }
+      bit.phase = phase;
+      if (bit.lifespan != 0 && bit.age() > bit.lifespan) {
+        bits.erase(bits.begin() + i);
+      }
+    }
+    for (AoSBit &bit : bits) {
+      handleUpdateBit(bit);
+    }
+    for (AoSBit &bit : bits) {
+      CRGB color = bit.color;
+      color.nscale8(bit.brightness);
+      ctx.markDirty();
+      ctx.leds[bit.px] = blend(ctx.leds[bit.px], color, 0xFF - bit.phase);
+      if (bit.phase > 0 && bit.nextPx != BitsFiller::NoPixel) {
+        ctx.leds[bit.nextPx] = blend(ctx.leds[bit.nextPx], color, bit.phase);
+      }
+    }
+    for (AoSBit &bit : bits) {
+      bit.firstFrame = false;
+    }
+  }
+};
+
+// bits pulsing with age as they go, the kind of per-bit work patterns hang on handleUpdateBit
+template <class Bit>
+static void pulseWithAge(Bit &bit) {
+  bit.brightness = sin8(bit.age() / 4);
+}
+
+void test_bench_soa_against_aos() {
+  const uint8_t populations[] = {64, 250};
+  for (uint8_t population : populations) {
+    const unsigned long start = g_millis;
+    random16_set_seed(1337);
+    ctx.clear();
+    // bits circling forever, so neither side spends the bench spawning or killing
+    BitsFiller filler(ctx, 0, 30, 0, {EdgeType::clockwise}, population);
+    filler.flowRule = BitsFiller::priority;
+    filler.spawnRule = BitsFiller::manualSpawn;
+    filler.mergeCollisions = false;
+    filler.handleUpdateBit = pulseWithAge<BitsFiller::Bit>;
+    for (uint8_t b = 0; b < population; ++b) {
+      filler.addBit().px = circleleds[b % circleleds.size()];
+    }
+    AoSFiller aos(filler);
+    aos.handleUpdateBit = pulseWithAge<AoSBit>;
+
+    // both step to the same frames
+    for (unsigned f = 0; f < 100; ++f) {
+      g_millis += 8;
+      filler.update(g_millis);
+    }
+    CRGBArray<NUM_LEDS> soaFrame = ctx.leds;
+    g_millis = start;
+    ctx.clear();
+    for (unsigned f = 0; f < 100; ++f) {
+      g_millis += 8;
+      aos.update(g_millis);
+    }
+    TEST_ASSERT_EQUAL_MEMORY(&soaFrame[0], &ctx.leds[0], NUM_LEDS * sizeof(CRGB));
+
+    double aosNanos = benchNanos(2000, [&]() {
+      g_millis += 8;
+      aos.update(g_millis);
+    });
+    double soaNanos = benchNanos(2000, [&]() {
+      g_millis += 8;
+      filler.update(g_millis);
+    });
+    benchf("%3u bits: AoS step in four passes %7.1f ns, filler.update() %7.1f ns", population, aosNanos, soaNanos);
+  }
+}
+
+// Runs two emitter setups the way the patterns run them, a filler per emitter with the pattern fading the whole context
+// once a frame, then as one engine fading the same. feed(add, population) spawns any bits the pattern
+// adds itself, add(emitter) makes one. Returns nanoseconds per frame before and after.
+template <class Feed>
+static void benchEngineAgainstFillers(const BitsEmitter (&setup)[2], Feed feed, bool fading, double &before, double &after) {
+  const unsigned frames = 2000;
+  const uint8_t frameMillis = 8;
+
+  random16_set_seed(1337);
+  DecayTable fade(fading ? 42 : 0);
+  BitsFiller *fillers[2];
+  for (uint8_t i = 0; i < 2; ++i) {
+    const BitsEmitter &e = setup[i];
+    BitsFiller *filler = fillers[i] = new BitsFiller(ctx, e.maxSpawnBits, e.speed, e.lifespan, {});
+    filler->bitDirections = e.bitDirections;
+    filler->maxBitsPerSecond = e.maxBitsPerSecond;
+    filler->splitDirections = e.splitDirections;
+    filler->spawnPixels = e.spawnPixels;
+    filler->allowedPixels = e.allowedPixels;
+    filler->flowRule = e.flowRule;
+    filler->spawnRule = e.spawnRule;
+    filler->handleNewBit = e.handleNewBit;
+    filler->handleUpdateBit = e.handleUpdateBit;
+    filler->fade.setHalfLife(0);
+  }
+  before = benchNanos(frames, [&]() {
+    g_millis += frameMillis;
+    decayContexts(fade.factor(frameMillis), ctx);
+    feed([&](uint8_t e) { return fillers[e]->addBit(); }, fillers[0]->bits.size() + fillers[1]->bits.size());
+    fillers[0]->update(g_millis);
+    fillers[1]->update(g_millis);
+  });
+  delete fillers[0];
+  delete fillers[1];
+
+  random16_set_seed(1337);
+  BitsEngine<2> engine(ctx);
+  engine.emitters[0] = setup[0];
+  engine.emitters[1] = setup[1];
+  engine.fade.setHalfLife(fade.halfLifeMillis());
+  after = benchNanos(frames, [&]() {
+    g_millis += frameMillis;
+    feed([&](uint8_t e) { return engine.addBit(e); }, engine.bits.size());
+    engine.update(g_millis);
+  });
+}
+
+template <class Feed>
+static void benchEngineAgainstFillers(const char *name, const BitsEmitter (&setup)[2], Feed feed) {
+  double before, after, fadedBefore, fadedAfter;
+  benchEngineAgainstFillers(setup, feed, false, before, after);
+  benchEngineAgainstFillers(setup, feed, true, fadedBefore, fadedAfter);
+  benchf("%-9s two fillers %5.0f ns/frame, one engine %5.0f ns/frame. with fading %5.0f and %5.0f", name, before, after, fadedBefore, fadedAfter);
+}
+
+// emitter setups as CouplingPattern, IntersexFlagPattern and SoundBits make them
+void test_bench_engine_against_fillers() {
+  const PixelMask allowed[2] = {circleLedsMask | earthLedsMask, circleLedsMask | marsLedsMask};
+  BitsEmitter coupling[2];
+  for (int i = 0; i < 2; ++i) {
+    BitsEmitter &emitter = coupling[i];
+    emitter = BitsEmitter(8, 50, 3000, {Edge::outbound, Edge::clockwise | Edge::counterclockwise});
+    emitter.spawnPixels = &circleLedsMask;
+    emitter.allowedPixels = &allowed[i];
+    emitter.maxBitsPerSecond = 10;
+    emitter.flowRule = BitsFiller::split;
+    emitter.splitDirections = EdgeType::outbound;
+  }
+  benchEngineAgainstFillers("coupling", coupling, [](auto add, unsigned population) { });
+
+  BitsEmitter intersex[2];
+  intersex[0] = BitsEmitter(20, 40, 4000, {EdgeType::inbound});
+  intersex[0].allowedPixels = &spokeLedsMask;
+  intersex[0].spawnPixels = &leafLedsMask;
+  intersex[0].maxBitsPerSecond = 30;
+  intersex[1] = BitsEmitter(8, 40, 4000, {EdgeType::clockwise | EdgeType::counterclockwise});
+  intersex[1].spawnPixels = &circleLedsMask;
+  intersex[1].maxBitsPerSecond = 8;
+  benchEngineAgainstFillers("intersex", intersex, [](auto add, unsigned population) { });
+
+  auto fadeWithAge = [](BitsFiller::Bit &bit) {
+    bit.brightness = 0xFF - 0xFF * MIN(bit.age(), bit.lifespan) / bit.lifespan;
+  };
+  BitsEmitter sound[2];
+  sound[0] = BitsEmitter(0, 60, 1200, {EdgeType::outbound, EdgeType::clockwise | EdgeType::counterclockwise});
+  sound[0].flowRule = BitsFiller::random;
+  sound[0].spawnPixels = &circleLedsMask;
+  sound[0].handleUpdateBit = fadeWithAge;
+  sound[1] = BitsEmitter(0, 60, 1200, {EdgeType::inbound, EdgeType::clockwise | EdgeType::counterclockwise});
+  sound[1].flowRule = BitsFiller::random;
+  sound[1].spawnPixels = &leafLedsMask;
+  sound[1].handleUpdateBit = fadeWithAge;
+  // steady music, a few bits a frame up to SoundBits' cap of 50
+  benchEngineAgainstFillers("soundbits", sound, [](auto add, unsigned population) {
+    for (uint8_t i = 0; i < 3 && population + i < 50; ++i) {
+      add(random8(5) == 0 ? 0 : 1);
+    }
+  });
+}
+
+// a frame of a filler with a bit for every four LEDs circling a ring of LEDCount, returning nanoseconds per LED
+template <unsigned LEDCount>
+static double nanosPerLEDOnRing() {
+  typedef RingLayout<LEDCount> Layout;
+  typedef BasicBitsFiller<FixedFlow<BitsRules::random>, FixedSpawn<BitsRules::maintainPopulation>, NoBitHandler, NoBitHandler, Layout> Filler;
+  LayoutDrawingContext<Layout> ringCtx;
+  Filler filler(ringCtx, LEDCount / 4, 30, 0, {EdgeType::clockwise});
+  filler.mergeCollisions = false;
+  return benchNanos(400000 / LEDCount, [&]() {
+    g_millis += 8;
+    filler.update(g_millis);
+  }) / LEDCount;
+}
+
+void test_bench_filler_scaling() {
+  double perLED[] = {nanosPerLEDOnRing<78>(), nanosPerLEDOnRing<300>(), nanosPerLEDOnRing<1000>()};
+  benchf("filler frame on a ring of 78, 300, 1000 LEDs: %.1f, %.1f, %.1f ns/LED", perLED[0], perLED[1], perLED[2]);
+  // fading is linear in LEDs and the bits are a fixed share of them, a bigger board shouldn't cost more per LED
+  TEST_ASSERT_TRUE(perLED[2] < 2 * perLED[0]);
+}
+
+// a blood red bit drawn once into accumulated trails and left to fade in steps of stepMillis, returning the blue channel
+// at each step. the bit's 1ms lifespan ends it on the next step.
+static vector<uint8_t> fadeBlueTail(unsigned long stepMillis, unsigned long forMillis) {
+  SplitFiller filler(ctx, 0, 10, 1, {EdgeType::outbound});
+  filler.fade.setHalfLife(57);
+  filler.accumulateTrails();
+  SplitFiller::Bit bit = filler.addBit();
+  bit.px = 14;
+  bit.color = CRGB(0xFF, 0, 0x50);
+  filler.update(g_millis);
+  vector<uint8_t> blue = {ctx.leds[14].b};
+  for (unsigned long t = stepMillis; t <= forMillis; t += stepMillis) {
+    g_millis += stepMillis;
+    filler.update(g_millis);
+    blue.push_back(ctx.leds[14].b);
+  }
+  return blue;
+}
+
+void test_accumulated_trails_follow_the_half_life() {
+  for (unsigned long stepMillis : {8, 33}) {
+    ctx.clear();
+    const vector<uint8_t> blue = fadeBlueTail(stepMillis, 400);
+    for (unsigned i = 0; i < blue.size(); ++i) {
+      const double exact = blue[0] * exp2(-(double)(i * stepMillis) / 57);
+      // dithered, every frame is within a step of the 8.8 trail, which starts up to a step's fraction over blue[0]
+      TEST_ASSERT_FLOAT_WITHIN(1.5, exact, blue[i]);
+    }
+  }
+}
+
+// a frame of HeartBeat-sized trails at 120fps, through to the encoded LED frame
+static double nanosPerTrailsFrame(bool accumulate) {
+  BasicBitsFiller<FixedFlow<BitsRules::split>, FixedSpawn<BitsRules::maintainPopulation>> filler(ctx, 12, 30, 1200, {EdgeType::outbound});
+  filler.fade.setHalfLife(57);
+  if (accumulate) {
+    filler.accumulateTrails();
+  }
+  ledOutput.begin(ctx.leds);
+  return benchNanos(20000, [&]() {
+    g_millis += 8;
+    filler.update(g_millis);
+    ledOutput.show();
+    ledOutput.sink.stream.clear();
+  });
+}
+
+void test_bench_accumulated_trails_at_120fps() {
+  const double budget = 1000000000. / 120;
+  double frame8 = nanosPerTrailsFrame(false);
+  double frame16 = nanosPerTrailsFrame(true);
+  benchf("trails frame at 120fps: 8-bit %.0f ns, 8.8 %.0f ns, of a %.0f ns budget", frame8, frame16, budget);
+  // the M0+ at 48MHz with flash wait states runs this sort of code a couple hundred times slower than a desktop core,
+  // so the host frame has to come in under 1/200 of the budget to fit on the board
+  TEST_ASSERT_TRUE(frame16 < budget / 200);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_split_copies_keep_parent_phase);
+  RUN_TEST(test_split_copies_finish_the_step);
+  RUN_TEST(test_merging_bounds_population);
+  RUN_TEST(test_downstream_population);
+  RUN_TEST(test_heartbeat_population);
+  RUN_TEST(test_chargespoke_population);
+  RUN_TEST(test_fixed_step_frames_ignore_jitter);
+  RUN_TEST(test_accumulated_trails_follow_the_half_life);
+  RUN_TEST(test_bench_update_cost_flat_in_population);
+  RUN_TEST(test_bench_soa_against_aos);
+  RUN_TEST(test_bench_engine_against_fillers);
+  RUN_TEST(test_bench_filler_scaling);
+  RUN_TEST(test_bench_accumulated_trails_at_120fps);
+  return UNITY_END();
+}
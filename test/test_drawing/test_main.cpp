@@ -0,0 +1,491 @@
+#include <Arduino.h>
+#include <FastLED.h>
+#include <unity.h>
+
+#include "util.h"
+#include "drawing.h"
+#include "ledgraph.h"
+
+#include "bench.h"
+#include "ringlayouts.h"
+
+void setUp() {
+  random16_set_seed(1337);
+}
+void tearDown() { }
+
+static const BlendMode kBlendModes[] = {blendSourceOver, blendBrighten, blendDarken, blendSubtract};
+
+// what each mode does to one channel, written out a channel at a time. brightness scales src like FastLED's nscale8.
+static uint8_t referenceBlend(uint8_t dst, uint8_t src, BlendMode mode, uint8_t brightness) {
+  src = (src * (brightness + 1)) >> 8;
+  switch (mode) {
+    case blendSourceOver: return src;
+    case blendBrighten: return MAX(src, dst);
+    case blendDarken: return MIN(src, dst);
+    case blendSubtract: return dst > src ? dst - src : 0;
+  }
+  return dst;
+}
+
+// a word holding a in the given lane and noise in the others
+static uint32_t inLane(uint8_t a, uint8_t lane, uint32_t noise) {
+  return (noise & ~(0xFFu << 8 * lane)) | ((uint32_t)a << 8 * lane);
+}
+
+static uint8_t lane(uint32_t word, uint8_t lane) {
+  return word >> 8 * lane;
+}
+
+void test_packed_channel_helpers() {
+  // every pair of channel values in every lane, with the other lanes holding whatever's there
+  for (unsigned a = 0; a < 0x100; ++a) {
+    for (unsigned b = 0; b < 0x100; ++b) {
+      for (uint8_t l = 0; l < 4; ++l) {
+        uint32_t A = inLane(a, l, random16() << 16 | random16());
+        uint32_t B = inLane(b, l, random16() << 16 | random16());
+        for (uint8_t o = 0; o < 4; ++o) {
+          uint8_t x = lane(A, o), y = lane(B, o);
+          TEST_ASSERT_EQUAL_UINT8(x > y ? x - y : 0, lane(qsub8x4(A, B), o));
+          TEST_ASSERT_EQUAL_UINT8(MAX(x, y), lane(max8x4(A, B), o));
+          TEST_ASSERT_EQUAL_UINT8(MIN(x, y), lane(min8x4(A, B), o));
+          TEST_ASSERT_EQUAL_UINT8((x * (b + 1)) >> 8, lane(scale8x4(A, b), o));
+        }
+      }
+    }
+  }
+}
+
+// a word holding a in the given 16-bit lane and noise in the other
+static uint32_t inLane16(uint16_t a, uint8_t lane, uint32_t noise) {
+  return (noise & ~(0xFFFFu << 16 * lane)) | ((uint32_t)a << 16 * lane);
+}
+
+static uint16_t lane16(uint32_t word, uint8_t lane) {
+  return word >> 16 * lane;
+}
+
+void test_packed_16_bit_channel_helpers() {
+  // every value against every value a byte apart in both halves, and against the values either side of it where the
+  // borrows and carries turn over, in either lane with the other holding whatever's there
+  const uint16_t brightnesses[] = {0, 1, 0x7F, 0xFE, 0xFF};
+  for (unsigned a = 0; a < 0x10000; ++a) {
+    uint16_t others[0x100 + 4] = {(uint16_t)a, (uint16_t)(a + 1), (uint16_t)(a - 1), (uint16_t)~a};
+    for (unsigned k = 0; k < 0x100; ++k) {
+      others[4 + k] = k * 0x101;
+    }
+    for (uint16_t b : others) {
+      const uint8_t l = b & 1;
+      uint32_t A = inLane16(a, l, random16() << 16 | random16());
+      uint32_t B = inLane16(b, l, random16() << 16 | random16());
+      for (uint8_t o = 0; o < 2; ++o) {
+        uint16_t x = lane16(A, o), y = lane16(B, o);
+        TEST_ASSERT_EQUAL_UINT16(x > y ? x - y : 0, lane16(qsub16x2(A, B), o));
+        TEST_ASSERT_EQUAL_UINT16(MIN(x + y, 0xFFFF), lane16(qadd16x2(A, B), o));
+        TEST_ASSERT_EQUAL_UINT16(MAX(x, y), lane16(max16x2(A, B), o));
+        TEST_ASSERT_EQUAL_UINT16(MIN(x, y), lane16(min16x2(A, B), o));
+      }
+    }
+    for (uint16_t brightness : brightnesses) {
+      uint32_t A = inLane16(a, a & 1, random16() << 16 | random16());
+      uint32_t B = random16() << 16 | random16();
+      for (uint8_t o = 0; o < 2; ++o) {
+        uint16_t x = lane16(A, o), y = lane16(B, o);
+        // src scaled, blended over dst
+        uint16_t scaled = (x >> 8) * (brightness + 1) + (((x & 0xFF) * (brightness + 1)) >> 8);
+        TEST_ASSERT_EQUAL_UINT16(scaled, lane16(blend16x2<blendSourceOver, true>(B, A, brightness), o));
+        TEST_ASSERT_EQUAL_UINT16(MAX(scaled, y), lane16(blend16x2<blendBrighten, true>(B, A, brightness), o));
+        TEST_ASSERT_EQUAL_UINT16(MIN(scaled, y), lane16(blend16x2<blendDarken, true>(B, A, brightness), o));
+        TEST_ASSERT_EQUAL_UINT16(y > scaled ? y - scaled : 0, lane16(blend16x2<blendSubtract, true>(B, A, brightness), o));
+        TEST_ASSERT_EQUAL_UINT16(y > x ? y - x : 0, lane16(blend16x2<blendSubtract, false>(B, A, brightness), o));
+      }
+    }
+  }
+  // and scaling every value by every factor
+  for (unsigned a = 0; a < 0x10000; ++a) {
+    uint32_t A = inLane16(a, a & 1, random16() << 16 | random16());
+    for (unsigned fixed = 0; fixed <= 0x100; ++fixed) {
+      for (uint8_t o = 0; o < 2; ++o) {
+        uint16_t x = lane16(A, o);
+        TEST_ASSERT_EQUAL_UINT16((x >> 8) * fixed + (((x & 0xFF) * fixed) >> 8), lane16(scale16x2(A, fixed), o));
+      }
+    }
+  }
+}
+
+// how far an 8.8 channel is from a float one, in 8.8 steps
+static double qcrgbError(const QCRGB &q, const double (&f)[3]) {
+  double error = 0;
+  for (uint8_t c = 0; c < 3; ++c) {
+    error = MAX(error, fabs(q.raw[c] - f[c]));
+  }
+  return error;
+}
+
+void test_qcrgb_matches_float_reference() {
+  for (int trial = 0; trial < 10000; ++trial) {
+    QCRGB p(random16(), random16(), random16()), q(random16(), random16(), random16());
+    const uint8_t amount = random8();
+    double scaled[3], blended[3], sum[3], diff[3];
+    for (uint8_t c = 0; c < 3; ++c) {
+      scaled[c] = p.raw[c] * (amount + 1) / 256.;
+      blended[c] = p.raw[c] * (256 - amount) / 256. + q.raw[c] * amount / 256.;
+      sum[c] = MIN(p.raw[c] + q.raw[c], 0xFFFF);
+      diff[c] = MAX(p.raw[c] - q.raw[c], 0);
+    }
+    // each truncates at most once per byte of the channel, a couple of 8.8 steps
+    TEST_ASSERT_TRUE(qcrgbError(QCRGB(p).nscale8(amount), scaled) < 2);
+    TEST_ASSERT_TRUE(qcrgbError(blend(p, q, amount), blended) < 3);
+    TEST_ASSERT_TRUE(qcrgbError(p + q, sum) == 0);
+    TEST_ASSERT_TRUE(qcrgbError(p - q, diff) == 0);
+    TEST_ASSERT_EQUAL_UINT16(0, p.unused);
+  }
+
+  // a pixel eased toward a color and faded for a couple hundred frames ends up within a quarter of an 8-bit step of the
+  // same done in floats, where at 8 bits the truncation piles up into whole steps
+  QCRGB pixel(CRGB(0xFF, 0x40, 0x08));
+  CRGB pixel8(0xFF, 0x40, 0x08);
+  double exact[3] = {0xFF00, 0x4000, 0x0800};
+  const QCRGB target(CRGB(0x20, 0xC0, 0x60));
+  for (int frame = 0; frame < 200; ++frame) {
+    pixel = blend(pixel, target, 12);
+    pixel8 = blend(pixel8, CRGB(target), 12);
+    if (frame % 2 == 0) {
+      pixel.nscale8(0xF8);
+      pixel8.nscale8(0xF8);
+    }
+    for (uint8_t c = 0; c < 3; ++c) {
+      exact[c] = exact[c] * (256 - 12) / 256. + target.raw[c] * 12 / 256.;
+      if (frame % 2 == 0) {
+        exact[c] = exact[c] * 0xF9 / 256.;
+      }
+    }
+    TEST_ASSERT_TRUE(qcrgbError(pixel, exact) < 0x40);
+  }
+  double error8 = 0;
+  for (uint8_t c = 0; c < 3; ++c) {
+    error8 = MAX(error8, fabs(pixel8[c] * 256. - exact[c]));
+  }
+  TEST_ASSERT_TRUE(error8 > qcrgbError(pixel, exact));
+}
+
+void test_blend_modes_match_reference() {
+  const uint8_t brightnesses[] = {0, 1, 100, 254, 255};
+  for (BlendMode mode : kBlendModes) {
+    for (uint8_t brightness : brightnesses) {
+      for (int trial = 0; trial < 20; ++trial) {
+        EVMDrawingContext src, dst;
+        CRGB expected[NUM_LEDS];
+        for (unsigned i = 0; i < NUM_LEDS; ++i) {
+          // some all-black sources, which blending can skip
+          src.leds[i] = trial % 5 == 0 ? CRGB(0, 0, 0) : CRGB(random8(), random8(), random8());
+          dst.leds[i] = CRGB(random8(), random8(), random8());
+          for (uint8_t c = 0; c < 3; ++c) {
+            expected[i][c] = referenceBlend(dst.leds[i][c], src.leds[i][c], mode, brightness);
+          }
+        }
+        if (trial % 5 != 0) {
+          src.markDirty();
+        }
+        dst.markDirty();
+        src.blendIntoContext(dst, mode, brightness);
+        TEST_ASSERT_EQUAL_MEMORY(expected, &dst.leds[0], sizeof(expected));
+      }
+    }
+  }
+}
+
+void test_darken_keeps_the_darker_channel() {
+  // set_px used to fall through from darken into subtract
+  EVMDrawingContext src, dst;
+  src.leds.fill_solid(CRGB(50, 200, 0));
+  dst.leds.fill_solid(CRGB(100, 100, 100));
+  src.markDirty();
+  dst.markDirty();
+  src.blendIntoContext(dst, blendDarken);
+  for (unsigned i = 0; i < NUM_LEDS; ++i) {
+    TEST_ASSERT_EQUAL_UINT8(50, dst.leds[i].r);
+    TEST_ASSERT_EQUAL_UINT8(100, dst.leds[i].g);
+    TEST_ASSERT_EQUAL_UINT8(0, dst.leds[i].b);
+  }
+}
+
+void test_unaligned_channels() {
+  // buffers that aren't word aligned take the byte at a time path
+  for (uint8_t offset = 1; offset < 4; ++offset) {
+    alignas(4) uint8_t src[70], dst[70];
+    uint8_t expected[66];
+    for (unsigned i = 0; i < 70; ++i) {
+      src[i] = random8();
+      dst[i] = random8();
+    }
+    for (unsigned i = 0; i < 66; ++i) {
+      expected[i] = referenceBlend(dst[i + offset], src[i], blendSubtract, 200);
+    }
+    blendChannels<blendSubtract, true>(dst + offset, src, 66, 200);
+    TEST_ASSERT_EQUAL_MEMORY(expected, dst + offset, sizeof(expected));
+  }
+}
+
+void test_bench_blend_kernels() {
+  const char *names[] = {"source over", "brighten", "darken", "subtract"};
+  EVMDrawingContext src, dst;
+  for (unsigned i = 0; i < NUM_LEDS; ++i) {
+    src.leds[i] = CRGB(random8(), random8(), random8());
+  }
+  src.markDirty();
+  for (BlendMode mode : kBlendModes) {
+    for (uint8_t brightness : {0xFF, 200}) {
+      double kernel = benchNanos(100000, [&]() {
+        src.blendIntoContext(dst, mode, brightness);
+        benchSink += dst.leds[0].r;
+      });
+      // the per-pixel scale and switch on mode that blendIntoContext replaced
+      double perPixel = benchNanos(100000, [&]() {
+        for (unsigned i = 0; i < NUM_LEDS; ++i) {
+          for (uint8_t c = 0; c < 3; ++c) {
+            dst.leds[i][c] = referenceBlend(dst.leds[i][c], src.leds[i][c], mode, brightness);
+          }
+        }
+        benchSink += dst.leds[0].r;
+      });
+      benchf("%-11s at %3u: kernel %6.1f ns/frame, per pixel %6.1f ns/frame", names[mode], brightness, kernel, perPixel);
+    }
+  }
+}
+
+// PatternManager's stack, a pattern and a spoke's drawing and subtraction layers, over a ring of LEDCount.
+// Returns nanoseconds per LED for one compose.
+template <unsigned LEDCount>
+static double composeNanosPerLED() {
+  typedef LayoutDrawingContext<RingLayout<LEDCount>> Context;
+  typedef BasicPixelMask<LEDCount> Mask;
+  Compositor<Context, Mask, blendBrighten, blendBrighten, blendSubtract> compositor;
+  Context layers[3], out;
+  Mask spoke;
+  for (unsigned i = 0; i < LEDCount; ++i) {
+    for (Context &layer : layers) {
+      layer.leds[i] = CRGB(random8(), random8(), random8());
+    }
+    if (i % 3 == 0) {
+      spoke.insert(i);
+    }
+  }
+  for (uint8_t l = 0; l < 3; ++l) {
+    layers[l].markDirty();
+    compositor.layers[l].source = &layers[l];
+    compositor.layers[l].mask = (l == 0 ? NULL : &spoke);
+  }
+  compositor.layers[0].opacity = 0xC0;
+  return benchNanos(2000000 / LEDCount, [&]() {
+    compositor.compose(out);
+    benchSink += out.leds[LEDCount - 1].r;
+  }) / LEDCount;
+}
+
+void test_bench_compositor_scaling() {
+  double perLED[] = {composeNanosPerLED<78>(), composeNanosPerLED<300>(), composeNanosPerLED<1000>()};
+  benchf("compose three layers over 78, 300, 1000 LEDs: %.2f, %.2f, %.2f ns/LED", perLED[0], perLED[1], perLED[2]);
+  // one pass over every LED, bigger boards only spread the per-frame setup thinner
+  TEST_ASSERT_TRUE(perLED[2] < 2 * perLED[0]);
+}
+
+static const uint16_t kHalfLife = 120;
+static const unsigned kFrameRates[] = {30, 60, 120};
+
+void test_decay_table_follows_the_curve_at_any_frame_rate() {
+  DecayTable fade(kHalfLife);
+  for (unsigned fps : kFrameRates) {
+    const unsigned frameMillis = 1000 / fps;
+    uint64_t left = (uint64_t)DecayTable::One << 16; // 0.32, so the product doesn't lose bits along the way
+    for (unsigned t = frameMillis; t <= 1000; t += frameMillis) {
+      left = (left * fade.factor(frameMillis)) >> 16;
+      const double exact = exp2(-(double)t / kHalfLife);
+      TEST_ASSERT_FLOAT_WITHIN(0.002, exact, (double)left / ((uint64_t)DecayTable::One << 16));
+    }
+  }
+  // a frame too long for the table chains its longest step
+  TEST_ASSERT_FLOAT_WITHIN(0.002, exp2(-300. / kHalfLife), (double)fade.factor(300) / DecayTable::One);
+}
+
+void test_accumulation_decay_follows_the_curve_at_any_frame_rate() {
+  for (unsigned fps : kFrameRates) {
+    const unsigned frameMillis = 1000 / fps;
+    DecayTable fade(kHalfLife);
+    AccumulationContext<8, 1> trail;
+    trail.leds.fill_solid(CRGB(0xFF, 0x80, 0x10));
+    trail.markDirty();
+    for (unsigned t = frameMillis; t <= 1000; t += frameMillis) {
+      trail.decay(fade.factor(frameMillis));
+      const double left = exp2(-(double)t / kHalfLife);
+      // truncating 8.8 loses less than a 256th of a step a frame, well under a step over a second even at 120fps
+      TEST_ASSERT_FLOAT_WITHIN(1, 0xFF * left, trail.leds[0].r / 256.);
+      TEST_ASSERT_FLOAT_WITHIN(1, 0x80 * left, trail.leds[0].g / 256.);
+      TEST_ASSERT_FLOAT_WITHIN(1, 0x10 * left, trail.leds[0].b / 256.);
+    }
+  }
+}
+
+// Fades a pair of 8-bit layers from full with the frames of fps, at floor(frame * 1000 / fps) milliseconds like a
+// millis() clock, filling curve with the red channel at each frame of 30fps. 120fps has a frame at every one of those.
+static void fade8BitAt(unsigned fps, uint16_t halfLife, uint8_t (&curve)[31]) {
+  DecayTable fade(halfLife);
+  CustomDrawingContext<8, 1, CRGB, CRGBArray<8> > a, b;
+  a.leds.fill_solid(CRGB(0xFF, 0x80, 0x10));
+  b.leds.fill_solid(CRGB(0xFF, 0x80, 0x10));
+  a.markDirty();
+  b.markDirty();
+  CRGB previous = a.leds[0];
+  unsigned long now = 0;
+  for (unsigned frame = 1; frame <= fps; ++frame) {
+    const unsigned long t = frame * 1000 / fps;
+    decayContexts(fade.factor(t - now), a, b);
+    now = t;
+    for (unsigned i = 0; i < 8; ++i) {
+      // every pixel and every layer fading from the same value has the same value, so faint channels don't flicker
+      TEST_ASSERT_TRUE(a.leds[i] == a.leds[0] && b.leds[i] == a.leds[0]);
+    }
+    for (uint8_t c = 0; c < 3; ++c) {
+      TEST_ASSERT_TRUE(a.leds[0][c] <= previous[c]);
+    }
+    if (a.isBlack()) {
+      TEST_ASSERT_TRUE(0xFF * exp2(-(double)t / halfLife) < 1.5);
+    } else {
+      // with the fractions carried along, the 8.8 value truncates less than a 256th of a step a frame
+      const double left = exp2(-(double)t / halfLife);
+      const uint8_t *fractions = a.decayFractions();
+      TEST_ASSERT_FLOAT_WITHIN(0.5, 0xFF * left, a.leds[0].r + fractions[0] / 256.);
+      TEST_ASSERT_FLOAT_WITHIN(0.5, 0x10 * left, a.leds[0].b + fractions[2] / 256.);
+    }
+    if (frame % (fps / 30) == 0) {
+      curve[frame / (fps / 30)] = a.leds[0].r;
+    }
+    previous = a.leds[0];
+  }
+  TEST_ASSERT_TRUE(a.isBlack() && b.isBlack());
+}
+
+void test_8_bit_decay_follows_the_curve_at_any_frame_rate() {
+  const uint16_t halfLives[] = {42, kHalfLife};
+  for (uint16_t halfLife : halfLives) {
+    uint8_t slow[31] = {0}, fast[31] = {0};
+    fade8BitAt(30, halfLife, slow);
+    fade8BitAt(120, halfLife, fast);
+    for (unsigned frame = 1; frame <= 30; ++frame) {
+      TEST_ASSERT_INT_WITHIN(1, slow[frame], fast[frame]);
+    }
+    // and both go out when the curve drops under a step
+    const unsigned outMillis = halfLife * log2(0xFF);
+    for (unsigned frame = 1; frame <= 30; ++frame) {
+      const unsigned t = frame * 1000 / 30;
+      if (t + 34 < outMillis) {
+        TEST_ASSERT_TRUE(slow[frame] > 0 && fast[frame] > 0);
+      }
+    }
+  }
+}
+
+void test_resolved_trails_average_out_to_the_8_8_value() {
+  AccumulationContext<4, 1> trail;
+  CustomDrawingContext<4, 1, CRGB, CRGBArray<4> > resolved;
+  uint8_t residuals[3 * 4] = {0};
+
+  // held still, each channel averages out to its 8.8 value over 256 frames, up to 0xFF00 where 8 bits saturate
+  trail.leds[0] = QCRGB(0x0180, 0x1234, 0xFE80);
+  trail.leds[1] = QCRGB(0x0100, 0x7F01, 0x00FF);
+  trail.markDirty();
+  uint32_t sums[2][3] = {{0}};
+  for (unsigned frame = 0; frame < 256; ++frame) {
+    resolveContext(trail, resolved, residuals);
+    for (uint8_t i = 0; i < 2; ++i) {
+      for (uint8_t c = 0; c < 3; ++c) {
+        sums[i][c] += resolved.leds[i][c];
+      }
+    }
+  }
+  for (uint8_t i = 0; i < 2; ++i) {
+    for (uint8_t c = 0; c < 3; ++c) {
+      const uint16_t value = trail.leds[i][c];
+      // under a step goes out rather than flicker
+      TEST_ASSERT_INT_WITHIN(1, value < 0x100 ? 0 : value, sums[i][c]);
+    }
+  }
+
+  // fading, the output never runs more than a step ahead or behind the 8.8 trail summed over time
+  DecayTable fade(120);
+  trail.leds.fill_solid(CRGB(0xFF, 0x80, 0x10));
+  memset(residuals, 0, sizeof(residuals));
+  int32_t drift[3] = {0};
+  for (unsigned frame = 0; frame < 120 && !trail.isBlack(); ++frame) {
+    trail.decay(fade.factor(8));
+    resolveContext(trail, resolved, residuals);
+    for (uint8_t c = 0; c < 3; ++c) {
+      const uint16_t value = trail.leds[0][c];
+      if (value >= 0x100) {
+        drift[c] += ((int32_t)resolved.leds[0][c] << 8) - value;
+        TEST_ASSERT_TRUE(drift[c] > -0x100 && drift[c] <= 0x100);
+      }
+    }
+  }
+}
+
+void test_bench_qcrgb() {
+  typedef CustomDrawingContext<NUM_LEDS, 1, CRGB, CRGBArray<NUM_LEDS> > Context;
+  Context src8, dst8;
+  AccumulationContext<NUM_LEDS, 1> src16, dst16;
+  for (unsigned i = 0; i < NUM_LEDS; ++i) {
+    src8.leds[i] = CRGB(random8(), random8(), random8());
+    src16.leds[i] = QCRGB(random16(), random16(), random16());
+  }
+  src8.markDirty();
+  src16.markDirty();
+  DecayTable fade(120);
+  const uint32_t factor = fade.factor(8);
+
+  for (BlendMode mode : {blendSourceOver, blendBrighten}) {
+    double blend8 = benchNanos(100000, [&]() {
+      src8.blendIntoContext(dst8, mode, 200);
+      benchSink += dst8.leds[0].r;
+    });
+    double blend16 = benchNanos(100000, [&]() {
+      src16.blendIntoContext(dst16, mode, 200);
+      benchSink += dst16.leds[0].r;
+    });
+    benchf("%s at 200: CRGB %6.1f ns/frame, QCRGB %6.1f ns/frame", mode == blendSourceOver ? "source over" : "brighten   ", blend8, blend16);
+  }
+  // decaying the copy keeps it lit, the sources stay as they are for the next run
+  double decay8 = benchNanos(100000, [&]() {
+    dst8.markDirty();
+    decayContexts(factor, dst8);
+    benchSink += dst8.leds[0].r;
+  });
+  double decay16 = benchNanos(100000, [&]() {
+    dst16.markDirty();
+    dst16.decay(factor);
+    benchSink += dst16.leds[0].r;
+  });
+  uint8_t residuals[3 * NUM_LEDS] = {0};
+  double resolve = benchNanos(100000, [&]() {
+    resolveContext(src16, dst8, residuals);
+    benchSink += dst8.leds[0].r;
+  });
+  benchf("decay: CRGB %6.1f ns/frame, QCRGB %6.1f ns/frame. resolving QCRGB to CRGB %6.1f ns/frame", decay8, decay16, resolve);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_packed_channel_helpers);
+  RUN_TEST(test_packed_16_bit_channel_helpers);
+  RUN_TEST(test_qcrgb_matches_float_reference);
+  RUN_TEST(test_blend_modes_match_reference);
+  RUN_TEST(test_darken_keeps_the_darker_channel);
+  RUN_TEST(test_unaligned_channels);
+  RUN_TEST(test_decay_table_follows_the_curve_at_any_frame_rate);
+  RUN_TEST(test_accumulation_decay_follows_the_curve_at_any_frame_rate);
+  RUN_TEST(test_8_bit_decay_follows_the_curve_at_any_frame_rate);
+  RUN_TEST(test_resolved_trails_average_out_to_the_8_8_value);
+  RUN_TEST(test_bench_blend_kernels);
+  RUN_TEST(test_bench_compositor_scaling);
+  RUN_TEST(test_bench_qcrgb);
+  return UNITY_END();
+}
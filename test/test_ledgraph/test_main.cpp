@@ -0,0 +1,419 @@
+#include <Arduino.h>
+#include <FastLED.h>
+#include <unity.h>
+
+#include <bitset>
+#include <queue>
+
+#include "util.h"
+#include "ledgraph.h"
+
+#include "bench.h"
+
+// The graph as initLEDGraph() used to build it at boot, a vector of edges per vertex with each edge added from both
+// ends in declaration order. ledgraph has to list the same edges in the same order, flows take the first match.
+struct ReferenceGraph {
+  vector<vector<Edge> > adjList;
+
+  ReferenceGraph() : adjList(NUM_LEDS) {
+    vector<Edge> edges = {
+      // spoke connections
+      {30, 12, Edge::outbound}, {38, 39, Edge::outbound}, {65,66, Edge::outbound},
+
+      // earth arrow
+      {19,20, Edge::outbound}, {20,21, Edge::outbound}, {21,22, Edge::outbound},
+      {19,25, Edge::outbound}, {25,24, Edge::outbound}, {24,23, Edge::outbound},
+
+      // earth cross
+      {14,28, Edge::outbound}, {28, 29, Edge::outbound},
+      {14,27, Edge::outbound}, {27, 26, Edge::outbound},
+
+      // mars arrow
+      {46, 47, Edge::outbound}, {47, 48, Edge::outbound}, {48, 49, Edge::outbound},
+      {46, 52, Edge::outbound}, {52, 51, Edge::outbound}, {51, 50, Edge::outbound},
+
+      // venus cross
+      {70, 77, Edge::outbound}, {77, 76, Edge::outbound},
+      {70, 74, Edge::outbound}, {74, 75, Edge::outbound},
+    };
+    for (auto &edge : edges) {
+      addEdge(edge);
+    }
+    const vector<uint8_t> circle = {CIRCLE_LEDS};
+    for (unsigned i = 0; i < circle.size(); ++i) {
+      addEdge(Edge(circle[i], circle[mod_wrap(i+1, circle.size())], Edge::clockwise));
+    }
+    for (uint8_t i = 12; i < 19; ++i) {
+      addEdge(Edge(i, i+1, Edge::outbound));
+    }
+    for (uint8_t i = 39; i < 46; ++i) {
+      addEdge(Edge(i, i+1, Edge::outbound));
+    }
+    for (uint8_t i = 66; i < 73; ++i) {
+      addEdge(Edge(i, i+1, Edge::outbound));
+    }
+  }
+
+  void addEdge(Edge edge) {
+    adjList[edge.from].push_back(edge);
+    adjList[edge.to].push_back(edge.transpose());
+  }
+
+  void getAdjacencies(uint8_t vertex, EdgeTypes matching, vector<Edge> &insertInto) {
+    if (matching == 0) {
+      return;
+    }
+    for (Edge &edge : adjList[vertex]) {
+      if (edge.type & matching) {
+        insertInto.push_back(edge);
+      }
+    }
+  }
+
+  vector<Edge> adjacencies(uint8_t vertex, EdgeTypesPair pair) {
+    vector<Edge> adj;
+    getAdjacencies(vertex, pair.edgeTypes.first, adj);
+    getAdjacencies(vertex, pair.edgeTypes.second, adj);
+    return adj;
+  }
+};
+
+ReferenceGraph reference;
+
+void setUp() { }
+void tearDown() { }
+
+void test_csr_edges_match_reference() {
+  unsigned edgeCount = 0;
+  for (uint8_t v = 0; v < NUM_LEDS; ++v) {
+    TEST_ASSERT_EQUAL_UINT(reference.adjList[v].size(), ledgraph.degree(v));
+    edgeCount += ledgraph.degree(v);
+    // every combination of edge types, and all
+    for (unsigned matching = 0; matching <= 0x10; ++matching) {
+      EdgeTypes types = matching == 0x10 ? (EdgeTypes)EdgeType::all : matching;
+      vector<Edge> expected;
+      reference.getAdjacencies(v, types, expected);
+      unsigned i = 0;
+      for (Edge edge : ledgraph.edges(v, types)) {
+        TEST_ASSERT_TRUE_MESSAGE(i < expected.size(), "more edges than the reference");
+        TEST_ASSERT_EQUAL_UINT8(expected[i].from, edge.from);
+        TEST_ASSERT_EQUAL_UINT8(expected[i].to, edge.to);
+        TEST_ASSERT_EQUAL_UINT8(expected[i].type, edge.type);
+        ++i;
+      }
+      TEST_ASSERT_EQUAL_UINT(expected.size(), i);
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT(2 * kLEDEdgeCount, edgeCount);
+}
+
+void test_next_hops_match_reference_adjacencies() {
+  for (uint8_t v = 0; v < NUM_LEDS; ++v) {
+    for (unsigned first = 0; first < 0x10; ++first) {
+      for (unsigned second = 0; second < 0x10; ++second) {
+        EdgeTypesPair pair = MakeEdgeTypesPair({(EdgeTypes)first, (EdgeTypes)second});
+        vector<Edge> expected = reference.adjacencies(v, pair);
+        NextHops hops;
+        ledgraph.nextHops(v, pair, hops);
+        // NextHops holds MaxAdjacencies, which only truncates when both halves of the pair match the same edges
+        TEST_ASSERT_EQUAL_UINT(MIN(expected.size(), (size_t)MaxAdjacencies), hops.count);
+        for (uint8_t i = 0; i < hops.count; ++i) {
+          TEST_ASSERT_EQUAL_UINT8(expected[i].to, hops.px[i]);
+          TEST_ASSERT_EQUAL_UINT8(expected[i].type, hops.types[i]);
+        }
+      }
+    }
+  }
+}
+
+static void assertMaskHolds(const PixelMask &mask, const vector<uint8_t> &pixels) {
+  for (uint8_t px = 0; px < NUM_LEDS; ++px) {
+    TEST_ASSERT_EQUAL(std::find(pixels.begin(), pixels.end(), px) != pixels.end(), mask.contains(px));
+  }
+}
+
+void test_layout_carries_the_regions() {
+  TEST_ASSERT_EQUAL_UINT(NUM_LEDS, EVMLayout::LEDCount);
+  const EVMRegions &regions = EVMLayout::regions;
+  assertMaskHolds(regions.circle, {CIRCLE_LEDS});
+  assertMaskHolds(regions.leaves, {22, 23, 29, 26, 49, 50, 76, 75, 73});
+  assertMaskHolds(regions.earth, {EARTH_LEDS});
+  assertMaskHolds(regions.venus, {VENUS_LEDS});
+  assertMaskHolds(regions.mars, {MARS_LEDS});
+  assertMaskHolds(regions.earthAsVenus, {12, 13, 14, 15, 16, 17, 18, 19, 28, 29, 27, 26});
+  assertMaskHolds(regions.earthAsMars, {12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 25, 24, 23});
+  assertMaskHolds(regions.spokes, {EARTH_LEDS, VENUS_LEDS, MARS_LEDS});
+  // the shorthand names are the layout's masks, not copies
+  TEST_ASSERT_TRUE(&circleLedsMask == &regions.circle && &spokeLedsMask == &regions.spokes);
+}
+
+template <unsigned N>
+static void assertMaskMatches(const std::bitset<N> &expected, const BasicPixelMask<N> &mask) {
+  TEST_ASSERT_EQUAL_UINT(expected.count(), mask.size());
+  TEST_ASSERT_EQUAL(expected.none(), mask.empty());
+  unsigned n = 0;
+  for (unsigned px = 0; px < N; ++px) {
+    TEST_ASSERT_EQUAL(expected.test(px), mask.contains(px));
+    if (expected.test(px)) {
+      TEST_ASSERT_EQUAL_UINT(px, mask.nth(n++));
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT(NoPixelFor<typename BasicPixelMask<N>::Index>, mask.nth(n));
+  n = 0;
+  for (unsigned px : mask) {
+    TEST_ASSERT_TRUE(expected.test(px));
+    ++n;
+  }
+  TEST_ASSERT_EQUAL_UINT(expected.count(), n);
+}
+
+// pairs of random masks of random density, combined and edited alongside the same sets as std::bitsets
+template <unsigned N>
+static void assertMaskSetOperations() {
+  for (unsigned trial = 0; trial < 200; ++trial) {
+    std::bitset<N> expected[2];
+    BasicPixelMask<N> masks[2];
+    for (unsigned m = 0; m < 2; ++m) {
+      uint8_t density = random8();
+      for (unsigned px = 0; px < N; ++px) {
+        if (random8() < density) {
+          expected[m].set(px);
+          masks[m].insert(px);
+        }
+      }
+      assertMaskMatches<N>(expected[m], masks[m]);
+    }
+    assertMaskMatches<N>(expected[0] | expected[1], masks[0] | masks[1]);
+    assertMaskMatches<N>(expected[0] & expected[1], masks[0] & masks[1]);
+    TEST_ASSERT_EQUAL(expected[0] == expected[1], masks[0] == masks[1]);
+
+    BasicPixelMask<N> mask = masks[0];
+    std::bitset<N> bits = expected[0];
+    mask |= masks[1];
+    bits |= expected[1];
+    assertMaskMatches<N>(bits, mask);
+    TEST_ASSERT_TRUE(mask == (masks[0] | masks[1]));
+    mask &= masks[0];
+    bits &= expected[0];
+    assertMaskMatches<N>(bits, mask);
+    for (unsigned px = 0; px < N; ++px) {
+      if (random8() < 0x80) {
+        mask.erase(px);
+        bits.reset(px);
+      }
+    }
+    assertMaskMatches<N>(bits, mask);
+    mask.clear();
+    assertMaskMatches<N>(std::bitset<N>(), mask);
+  }
+  // the first and last pixel, in the first and last word
+  constexpr BasicPixelMask<N> ends = {0, N - 1};
+  std::bitset<N> expected;
+  expected.set(0).set(N - 1);
+  assertMaskMatches<N>(expected, ends);
+}
+
+void test_pixel_mask_matches_bitset() {
+  random16_set_seed(1337);
+  assertMaskSetOperations<NUM_LEDS>();
+  // past a byte of pixel index and off a word boundary
+  assertMaskSetOperations<300>();
+}
+
+// hop counts out of source over the reference graph, a breadth-first search with nothing precomputed
+static vector<uint8_t> referenceHops(uint8_t source, EdgeTypes matching) {
+  vector<uint8_t> hops(NUM_LEDS, NoPath);
+  std::queue<uint8_t> queue;
+  hops[source] = 0;
+  queue.push(source);
+  while (!queue.empty()) {
+    uint8_t v = queue.front();
+    queue.pop();
+    vector<Edge> adj;
+    reference.getAdjacencies(v, matching, adj);
+    for (Edge &edge : adj) {
+      if (hops[edge.to] == NoPath) {
+        hops[edge.to] = hops[v] + 1;
+        queue.push(edge.to);
+      }
+    }
+  }
+  return hops;
+}
+
+template <EdgeTypes Matching>
+static void assertHopsMatchSearch() {
+  const HopDistances<NUM_LEDS> &table = hopDistances<Matching>();
+  for (uint8_t from = 0; from < NUM_LEDS; ++from) {
+    vector<uint8_t> expected = referenceHops(from, Matching);
+    for (uint8_t to = 0; to < NUM_LEDS; ++to) {
+      TEST_ASSERT_EQUAL_UINT8(expected[to], table.distance(from, to));
+      TEST_ASSERT_EQUAL_UINT8(expected[to], table.fromSource(from)[to]);
+    }
+  }
+}
+
+void test_hop_distances_match_search() {
+  assertHopsMatchSearch<EdgeType::all>();
+  assertHopsMatchSearch<EdgeType::clockwise>();
+  assertHopsMatchSearch<EdgeType::counterclockwise>();
+  assertHopsMatchSearch<EdgeType::outbound>();
+  assertHopsMatchSearch<EdgeType::inbound>();
+
+  const HopDistances<NUM_LEDS> &all = hopDistances();
+  for (uint8_t a = 0; a < NUM_LEDS; ++a) {
+    for (uint8_t b = 0; b < NUM_LEDS; ++b) {
+      // the whole board is connected, and without a direction the way back is as long as the way there
+      TEST_ASSERT_TRUE(all.distance(a, b) != NoPath);
+      TEST_ASSERT_EQUAL_UINT8(all.distance(a, b), all.distance(b, a));
+      // directed edges run the opposite way seen from the other end
+      TEST_ASSERT_EQUAL_UINT8(hopDistances<EdgeType::clockwise>().distance(a, b), hopDistances<EdgeType::counterclockwise>().distance(b, a));
+      TEST_ASSERT_EQUAL_UINT8(hopDistances<EdgeType::outbound>().distance(a, b), hopDistances<EdgeType::inbound>().distance(b, a));
+    }
+  }
+}
+
+void test_nearest_matches_scan() {
+  const PixelMask targets[] = {circleLedsMask, leafLedsMask, PixelMask({33}), PixelMask()};
+  const HopDistances<NUM_LEDS> &outbound = hopDistances<EdgeType::outbound>();
+  for (const PixelMask &mask : targets) {
+    for (uint8_t source = 0; source < NUM_LEDS; ++source) {
+      uint8_t expected = NoPath;
+      for (uint8_t px : mask) {
+        expected = MIN(expected, outbound.distance(source, px));
+      }
+      uint8_t distance;
+      uint8_t nearest = outbound.nearest(source, mask, &distance);
+      TEST_ASSERT_EQUAL_UINT8(expected, distance);
+      TEST_ASSERT_EQUAL_UINT8(expected, outbound.distanceTo(source, mask));
+      if (expected == NoPath) {
+        TEST_ASSERT_EQUAL_UINT8(NoPixel, nearest);
+      } else {
+        TEST_ASSERT_TRUE(mask.contains(nearest));
+        TEST_ASSERT_EQUAL_UINT8(expected, outbound.distance(source, nearest));
+      }
+    }
+  }
+}
+
+void test_circle_is_a_ring_of_the_coordinates() {
+  // the circle as the old circleleds set listed it, by hand
+  assertMaskHolds(pixelsInRing(100, 110), {CIRCLE_LEDS});
+  TEST_ASSERT_TRUE(pixelsInRing(100, 110) == circleLedsMask);
+  // clockwise edges around the circle run forward in angle, a little at a time
+  for (uint8_t i = 0; i < circleleds.size(); ++i) {
+    uint8_t from = circleleds[i], to = circleleds[mod_wrap(i + 1, circleleds.size())];
+    uint8_t step = kLEDCoords[to].angle - kLEDCoords[from].angle;
+    TEST_ASSERT_TRUE(step > 0 && step < 0x100 / 16);
+    TEST_ASSERT_EQUAL_UINT8(step, angleDistance(kLEDCoords[to].angle, kLEDCoords[from].angle));
+  }
+  // kLEDsByAngle has each pixel once, by angle and then radius
+  PixelMask seen;
+  for (uint8_t i = 0; i < NUM_LEDS; ++i) {
+    seen.insert(kLEDsByAngle[i]);
+    if (i > 0) {
+      const LEDCoord &a = kLEDCoords[kLEDsByAngle[i - 1]], &b = kLEDCoords[kLEDsByAngle[i]];
+      TEST_ASSERT_TRUE(a.angle < b.angle || (a.angle == b.angle && a.radius <= b.radius));
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT(NUM_LEDS, seen.size());
+}
+
+void test_pixel_info_matches_old_ranges() {
+  const vector<uint8_t> circle = {CIRCLE_LEDS};
+  const vector<uint8_t> leaves = {22, 23, 29, 26, 49, 50, 76, 75, 73};
+  const vector<uint8_t> tips = {19, 46, 73};
+  const uint8_t junctions[] = {30, 65, 38};
+  for (uint8_t px = 0; px < NUM_LEDS; ++px) {
+    // the index ranges onEarth, onVenus and onMars tested before the table
+    bool earth = px >= 12 && px <= 29;
+    bool venus = px >= 66 && px <= 77;
+    bool mars = px >= 39 && px <= 52;
+    TEST_ASSERT_EQUAL(earth, onEarth(px));
+    TEST_ASSERT_EQUAL(venus, onVenus(px));
+    TEST_ASSERT_EQUAL(mars, onMars(px));
+
+    const PixelInfo &info = pixelInfo(px);
+    auto ring = std::find(circle.begin(), circle.end(), px);
+    if (ring != circle.end()) {
+      TEST_ASSERT_FALSE(earth || venus || mars);
+      TEST_ASSERT_EQUAL(PixelInfo::circle, info.region);
+      TEST_ASSERT_EQUAL_UINT8(ring - circle.begin(), info.ringIndex);
+      TEST_ASSERT_EQUAL_UINT8(NoSpoke, info.spoke);
+      TEST_ASSERT_EQUAL_UINT8(0, info.depth);
+    } else {
+      TEST_ASSERT_TRUE(earth || venus || mars);
+      uint8_t spoke = earth ? 0 : venus ? 1 : 2;
+      TEST_ASSERT_EQUAL(PixelInfo::earth + spoke, info.region);
+      TEST_ASSERT_EQUAL_UINT8(NoPixel, info.ringIndex);
+      TEST_ASSERT_EQUAL_UINT8(spoke, info.spoke);
+      TEST_ASSERT_EQUAL_UINT8(referenceHops(junctions[spoke], EdgeType::outbound)[px], info.depth);
+    }
+    TEST_ASSERT_EQUAL(std::find(leaves.begin(), leaves.end(), px) != leaves.end(), (info.flags & PixelInfo::leaf) != 0);
+    TEST_ASSERT_EQUAL(std::find(tips.begin(), tips.end(), px) != tips.end(), (info.flags & PixelInfo::tip) != 0);
+  }
+}
+
+// the direction pairs the patterns flow along most
+static vector<EdgeTypesPair> benchPairs() {
+  return {
+    MakeEdgeTypesPair({EdgeType::outbound, EdgeType::clockwise}),
+    MakeEdgeTypesPair({EdgeType::inbound, EdgeType::clockwise | EdgeType::counterclockwise}),
+    MakeEdgeTypesPair({EdgeType::all}),
+  };
+}
+
+void test_bench_edge_iteration() {
+  const vector<EdgeTypesPair> pairs = benchPairs();
+  const double visits = pairs.size() * NUM_LEDS;
+  double vectors = benchNanos(2000, [&]() {
+    for (EdgeTypesPair pair : pairs) {
+      for (uint8_t v = 0; v < NUM_LEDS; ++v) {
+        for (Edge &edge : reference.adjacencies(v, pair)) {
+          benchSink += edge.to;
+        }
+      }
+    }
+  }) / visits;
+  double views = benchNanos(2000, [&]() {
+    for (EdgeTypesPair pair : pairs) {
+      for (uint8_t v = 0; v < NUM_LEDS; ++v) {
+        for (Edge edge : ledgraph.edges(v, pair.edgeTypes.first)) {
+          benchSink += edge.to;
+        }
+        for (Edge edge : ledgraph.edges(v, pair.edgeTypes.second)) {
+          benchSink += edge.to;
+        }
+      }
+    }
+  }) / visits;
+  double hops = benchNanos(2000, [&]() {
+    for (EdgeTypesPair pair : pairs) {
+      for (uint8_t v = 0; v < NUM_LEDS; ++v) {
+        NextHops next;
+        ledgraph.nextHops(v, pair, next);
+        for (uint8_t i = 0; i < next.count; ++i) {
+          benchSink += next.px[i];
+        }
+      }
+    }
+  }) / visits;
+  benchf("edges of a vertex: vector adjacencies %.1f ns, edges() view %.1f ns, nextHops %.1f ns", vectors, views, hops);
+  // neither of the views allocates, they should be well clear of building a vector per vertex
+  TEST_ASSERT_TRUE(views < vectors);
+  TEST_ASSERT_TRUE(hops < vectors);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_csr_edges_match_reference);
+  RUN_TEST(test_next_hops_match_reference_adjacencies);
+  RUN_TEST(test_layout_carries_the_regions);
+  RUN_TEST(test_pixel_mask_matches_bitset);
+  RUN_TEST(test_hop_distances_match_search);
+  RUN_TEST(test_nearest_matches_scan);
+  RUN_TEST(test_circle_is_a_ring_of_the_coordinates);
+  RUN_TEST(test_pixel_info_matches_old_ranges);
+  RUN_TEST(test_bench_edge_iteration);
+  return UNITY_END();
+}
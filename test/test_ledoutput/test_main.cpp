@@ -0,0 +1,275 @@
+#include <Arduino.h>
+#include <FastLED.h>
+#include <unity.h>
+
+#include "util.h"
+#include "drawing.h"
+#include "ledgraph.h"
+#include "ledoutput.h"
+
+EVMLEDOutput ledOutput;
+
+void setUp() {
+  g_millis = 1000;
+  random16_set_seed(1337);
+  FastLED.setBrightness(0xFF);
+}
+void tearDown() { }
+
+// FastLED's APA102Controller::showPixels with FASTLED_USE_GLOBAL_BRIGHTNESS and no dithering, what the LEDs got before
+// ledoutput.h. The end frame is APA102's ones or SK9822's zeros, a word for every 32 LEDs and one more.
+template <ESPIChipsets Chipset>
+static vector<uint8_t> referenceFrame(const CRGB *leds, unsigned count, uint8_t brightness) {
+  const uint16_t maxBrightness = 0x1F;
+  const uint16_t global = ((((uint16_t)brightness + 1) * maxBrightness - 1) >> 8) + 1;
+  const uint8_t scale = (maxBrightness * brightness + (global >> 1)) / global;
+  vector<uint8_t> frame = {0, 0, 0, 0};
+  for (unsigned i = 0; i < count; ++i) {
+    frame.push_back(0xE0 | global);
+    frame.push_back(scale8(leds[i].b, scale));
+    frame.push_back(scale8(leds[i].g, scale));
+    frame.push_back(scale8(leds[i].r, scale));
+  }
+  for (unsigned w = 0; w <= count / 32; ++w) {
+    const uint8_t end[] = {(uint8_t)(Chipset == SK9822 ? 0 : 0xFF), 0, 0, 0};
+    frame.insert(frame.end(), end, end + 4);
+  }
+  return frame;
+}
+
+static void randomize(CRGB *leds, unsigned count) {
+  for (unsigned i = 0; i < count; ++i) {
+    leds[i] = CRGB(random8(), random8(), random8());
+  }
+}
+
+template <ESPIChipsets Chipset>
+static void assertStreamMatchesReference() {
+  LEDOutput<Chipset, NUM_LEDS, kEVMOutputCurves, kEVMCurrentModel, RecordingSPISink> output;
+  CRGB leds[NUM_LEDS];
+  output.begin(leds);
+  vector<uint8_t> expected;
+  for (unsigned f = 0; f < 200; ++f) {
+    randomize(leds, NUM_LEDS);
+    output.show();
+    vector<uint8_t> frame = referenceFrame<Chipset>(leds, NUM_LEDS, 0xFF);
+    expected.insert(expected.end(), frame.begin(), frame.end());
+  }
+  TEST_ASSERT_EQUAL_UINT(expected.size(), output.sink.stream.size());
+  TEST_ASSERT_EQUAL_MEMORY(expected.data(), output.sink.stream.data(), expected.size());
+}
+
+void test_stream_matches_fastled_at_full_brightness() {
+  assertStreamMatchesReference<APA102>();
+  assertStreamMatchesReference<SK9822>();
+}
+
+void test_dimmed_stream_dithers_around_fastled() {
+  CRGB leds[NUM_LEDS];
+  randomize(leds, NUM_LEDS);
+  for (unsigned brightness = 1; brightness < 0xFF; brightness += 7) {
+    EVMLEDOutput output;
+    output.begin(leds);
+    FastLED.setBrightness(brightness);
+    const vector<uint8_t> reference = referenceFrame<kLEDChipset>(leds, NUM_LEDS, brightness);
+    const unsigned frames = 64;
+    for (unsigned f = 0; f < frames; ++f) {
+      output.show();
+    }
+    const vector<uint8_t> &stream = output.sink.stream;
+    TEST_ASSERT_EQUAL_UINT(frames * reference.size(), stream.size());
+    const uint16_t global = reference[4] & 0x1F;
+    const uint8_t scale = (0x1F * brightness + (global >> 1)) / global;
+    for (unsigned b = 0; b < reference.size(); ++b) {
+      unsigned sum = 0;
+      for (unsigned f = 0; f < frames; ++f) {
+        const uint8_t out = stream[f * reference.size() + b];
+        // each frame goes out at the reference value or a step above it, carrying what the reference drops
+        TEST_ASSERT_TRUE(out == reference[b] || out == reference[b] + 1);
+        sum += out;
+      }
+      const unsigned led = (b - 4) / 4, channel = (b - 4) % 4;
+      if (b >= 4 && led < NUM_LEDS && channel != 0 && reference[b] > 0) {
+        // and over the frames the channel averages out to the exact scaled value
+        const double exact = leds[led][3 - channel] * (scale + 1) / 256.;
+        TEST_ASSERT_FLOAT_WITHIN(1. / 16, exact, (double)sum / frames);
+      }
+    }
+  }
+}
+
+// the board's curves, and the per-channel gammas and white balance the palettes were converted with
+static_assert(kEVMOutputCurves.isIdentity(), "the board's curves are expected to be linear, see ledoutput.h");
+inline constexpr ChannelCurve kPaletteCurves[3] = {{2.6, 0xFF}, {2.2, 0xB0}, {2.5, 0xF0}};
+inline constexpr OutputCurves kPaletteOutputCurves = MakeOutputCurves(kPaletteCurves[0], kPaletteCurves[1], kPaletteCurves[2]);
+inline constexpr OutputCurves kGamma22Curves = MakeOutputCurves({2.2, 0xFF}, {2.2, 0xFF}, {2.2, 0xFF});
+static_assert(!kPaletteOutputCurves.isIdentity() && !kGamma22Curves.isIdentity(), "gamma curves aren't linear");
+
+// out = correction / 255 * in^gamma, in 8.8
+static double referenceCurve(ChannelCurve curve, double in) {
+  return pow(in / 255, curve.gamma) * curve.correction * 0x100;
+}
+
+void test_identity_curves_leave_values_alone() {
+  for (uint8_t c = 0; c < 3; ++c) {
+    for (uint32_t value = 0; value <= 0xFF00; ++value) {
+      TEST_ASSERT_EQUAL_UINT16(value, kEVMOutputCurves.apply(c, value));
+    }
+  }
+}
+
+static void assertCurvesMatchReference(const OutputCurves &curves, const ChannelCurve (&reference)[3]) {
+  for (uint8_t c = 0; c < 3; ++c) {
+    for (unsigned step = 0; step < 256; ++step) {
+      TEST_ASSERT_FLOAT_WITHIN(1, referenceCurve(reference[c], step), curves.tables[c][step]);
+    }
+    uint16_t previous = 0;
+    for (uint32_t value = 0; value <= 0xFF00; ++value) {
+      const uint16_t out = curves.apply(c, value);
+      // interpolating between steps stays within a couple of 256ths of a step of the curve, and never turns back down
+      TEST_ASSERT_FLOAT_WITHIN(2, referenceCurve(reference[c], value / 256.), out);
+      TEST_ASSERT_TRUE(out >= previous);
+      previous = out;
+    }
+  }
+}
+
+void test_gamma_curves_match_reference() {
+  const ChannelCurve gamma22[3] = {{2.2, 0xFF}, {2.2, 0xFF}, {2.2, 0xFF}};
+  assertCurvesMatchReference(kGamma22Curves, gamma22);
+  assertCurvesMatchReference(kPaletteOutputCurves, kPaletteCurves);
+}
+
+void test_curved_stream_follows_reference() {
+  LEDOutput<kLEDChipset, NUM_LEDS, kPaletteOutputCurves, kEVMCurrentModel, RecordingSPISink> output;
+  CRGB leds[NUM_LEDS];
+  randomize(leds, NUM_LEDS);
+  output.begin(leds);
+  output.show();
+  const uint8_t *led = output.sink.stream.data() + 4;
+  for (unsigned i = 0; i < NUM_LEDS; ++i, led += 4) {
+    TEST_ASSERT_EQUAL_HEX8(0xFF, led[0]);
+    for (uint8_t c = 0; c < 3; ++c) {
+      // blue, green, red, each through its own curve, and within a step of it
+      const double exact = referenceCurve(kPaletteCurves[2 - c], leds[i][2 - c]) / 256;
+      TEST_ASSERT_FLOAT_WITHIN(1, exact, led[1 + c]);
+    }
+  }
+}
+
+// kEVMCurrentModel's estimate for every LED at one color, at full brightness, in mA
+static double modelMilliamps(CRGB color) {
+  double microamps = kEVMCurrentModel.idleMicroamps;
+  for (uint8_t c = 0; c < 3; ++c) {
+    microamps += kEVMCurrentModel.channelMicroamps[c] * color[c] / 255.;
+  }
+  return NUM_LEDS * microamps / 1000;
+}
+
+static void fill(CRGB *leds, unsigned count, CRGB color) {
+  for (unsigned i = 0; i < count; ++i) {
+    leds[i] = color;
+  }
+}
+
+static void showFilled(EVMLEDOutput &output, CRGB *leds, CRGB color) {
+  fill(leds, NUM_LEDS, color);
+  output.show();
+}
+
+void test_current_model_on_synthetic_frames() {
+  EVMLEDOutput output;
+  CRGB leds[NUM_LEDS];
+  output.begin(leds);
+  // about 3A for full white, which is what the budget is there to stop
+  const CRGB frames[] = {CRGB::Black, CRGB::White, CRGB(0x80, 0, 0), CRGB(0, 0x40, 0xC0), CRGB(0x10, 0x10, 0x10)};
+  for (CRGB color : frames) {
+    showFilled(output, leds, color);
+    TEST_ASSERT_FLOAT_WITHIN(1, modelMilliamps(color), output.milliamps());
+  }
+  // dimming scales everything but the idle draw
+  for (unsigned brightness = 0x10; brightness < 0x100; brightness += 0x30) {
+    FastLED.setBrightness(brightness);
+    showFilled(output, leds, CRGB::White);
+    const double idle = NUM_LEDS * kEVMCurrentModel.idleMicroamps / 1000.;
+    const double expected = idle + (modelMilliamps(CRGB::White) - idle) * brightness / 255;
+    TEST_ASSERT_FLOAT_WITHIN(expected * 0.02, expected, output.milliamps());
+  }
+}
+
+void test_limiter_caps_bright_frames_to_the_budget() {
+  EVMLEDOutput output;
+  CRGB leds[NUM_LEDS];
+  output.begin(leds);
+  output.setCurrentBudget(LED_CURRENT_BUDGET_MA);
+
+  // a mostly dark frame is under budget as it is
+  fill(leds, NUM_LEDS, CRGB::Black);
+  fill(leds, 10, CRGB::White);
+  output.show();
+  TEST_ASSERT_EQUAL_UINT8(0xFF, output.brightness());
+
+  // full white is cut right away, to just under the budget
+  showFilled(output, leds, CRGB::White);
+  TEST_ASSERT_TRUE(output.milliamps() <= LED_CURRENT_BUDGET_MA);
+  TEST_ASSERT_TRUE(output.milliamps() > LED_CURRENT_BUDGET_MA * 0.95);
+  const uint8_t capped = output.brightness();
+  TEST_ASSERT_TRUE(capped < 0xFF);
+
+  // and stays cut while the frame stays bright
+  for (unsigned f = 0; f < 100; ++f) {
+    g_millis += 8;
+    showFilled(output, leds, CRGB::White);
+    TEST_ASSERT_TRUE(output.milliamps() <= LED_CURRENT_BUDGET_MA);
+  }
+
+  // once the frame is dark again, the cap comes back up gradually over about a second
+  unsigned long recovered = 0;
+  uint8_t previous = output.brightness();
+  for (unsigned long t = 8; t <= 2000 && !recovered; t += 8) {
+    g_millis += 8;
+    showFilled(output, leds, CRGB(0x10, 0, 0));
+    TEST_ASSERT_TRUE(output.brightness() >= previous);
+    previous = output.brightness();
+    if (previous == 0xFF) {
+      recovered = t;
+    }
+  }
+  TEST_ASSERT_TRUE(recovered > 200 && recovered < 1200);
+
+  // the next bright frame is cut again without waiting
+  showFilled(output, leds, CRGB::White);
+  TEST_ASSERT_EQUAL_UINT8(capped, output.brightness());
+
+  // whatever the frame and the brightness, dithering included
+  for (unsigned f = 0; f < 500; ++f) {
+    g_millis += 8;
+    FastLED.setBrightness(random8(0x80, 0xFF));
+    for (unsigned i = 0; i < NUM_LEDS; ++i) {
+      leds[i] = CRGB(random8(0x80, 0xFF), random8(0x80, 0xFF), random8(0x80, 0xFF));
+    }
+    output.show();
+    TEST_ASSERT_TRUE(output.milliamps() <= LED_CURRENT_BUDGET_MA);
+  }
+  FastLED.setBrightness(0xFF);
+
+  // a budget the LEDs' idle draw already uses up leaves them dark, and 0 turns the limit off
+  output.setCurrentBudget(50);
+  showFilled(output, leds, CRGB::White);
+  TEST_ASSERT_EQUAL_UINT8(0, output.brightness());
+  output.setCurrentBudget(0);
+  showFilled(output, leds, CRGB::White);
+  TEST_ASSERT_EQUAL_UINT8(0xFF, output.brightness());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_stream_matches_fastled_at_full_brightness);
+  RUN_TEST(test_dimmed_stream_dithers_around_fastled);
+  RUN_TEST(test_identity_curves_leave_values_alone);
+  RUN_TEST(test_gamma_curves_match_reference);
+  RUN_TEST(test_curved_stream_follows_reference);
+  RUN_TEST(test_current_model_on_synthetic_frames);
+  RUN_TEST(test_limiter_caps_bright_frames_to_the_budget);
+  return UNITY_END();
+}